@@ -0,0 +1,315 @@
+// Data path benchmark for new_rtlsdr_source.
+// Runs the usb buffer -> SPSC ring -> conversion -> dsp::stream swap path for every sample rate in
+// the menu and every buffering profile block size, plus the bare conversion kernels.
+// Output is one JSON object per line (or CSV with --csv) so runs can be diffed between releases.
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <atomic>
+#include <chrono>
+#include <new>
+#include <string>
+#include <thread>
+#include <vector>
+#include <dsp/stream.h>
+#include <dsp/types.h>
+#include "conversion.h"
+#include "spsc_ring.h"
+#include "decimator.h"
+#include "adc_stats.h"
+#include "raw_tap.h"
+#include "sample_rates.h"
+#include "buffer_profiles.h"
+
+// Count every heap allocation so the steady state can be checked for allocations
+static std::atomic<uint64_t> allocCount = 0;
+
+void* operator new(size_t size) {
+    allocCount++;
+    void* ptr = malloc(size ? size : 1);
+    if (!ptr) { throw std::bad_alloc(); }
+    return ptr;
+}
+
+void operator delete(void* ptr) noexcept {
+    free(ptr);
+}
+
+void operator delete(void* ptr, size_t) noexcept {
+    free(ptr);
+}
+
+struct Result {
+    std::string test;
+    std::string kernel;
+    double sampleRate;
+    int blockSize;
+    uint64_t samples;
+    double nsPerSample;
+    double msps;
+    double mspsPerCore;
+    uint64_t allocs;
+};
+
+static bool csv = false;
+
+static double cpuSeconds() {
+    return (double)clock() / (double)CLOCKS_PER_SEC;
+}
+
+static void print(const Result& r) {
+    if (csv) {
+        printf("%s,%s,%.0lf,%d,%llu,%.4lf,%.3lf,%.3lf,%llu\n", r.test.c_str(), r.kernel.c_str(), r.sampleRate, r.blockSize,
+               (unsigned long long)r.samples, r.nsPerSample, r.msps, r.mspsPerCore, (unsigned long long)r.allocs);
+    }
+    else {
+        printf("{\"test\":\"%s\",\"kernel\":\"%s\",\"sample_rate\":%.0lf,\"block_size\":%d,\"samples\":%llu,"
+               "\"ns_per_sample\":%.4lf,\"msps\":%.3lf,\"msps_per_core\":%.3lf,\"allocs\":%llu}\n",
+               r.test.c_str(), r.kernel.c_str(), r.sampleRate, r.blockSize, (unsigned long long)r.samples,
+               r.nsPerSample, r.msps, r.mspsPerCore, (unsigned long long)r.allocs);
+    }
+    fflush(stdout);
+}
+
+// Bare conversion kernel, single thread
+static Result benchConvert(cu8::Kernel kernel, int blockSize, uint64_t totalSamples) {
+    cu8::convert_t convert = cu8::get(kernel);
+    std::vector<uint8_t> in(blockSize);
+    std::vector<float> out(blockSize);
+    for (int i = 0; i < blockSize; i++) { in[i] = rand(); }
+
+    uint64_t blocks = std::max<uint64_t>(totalSamples / (blockSize / 2), 1);
+    uint64_t allocs = allocCount;
+    auto start = std::chrono::steady_clock::now();
+    double cpuStart = cpuSeconds();
+    for (uint64_t i = 0; i < blocks; i++) {
+        convert(in.data(), out.data(), blockSize);
+    }
+    double cpu = cpuSeconds() - cpuStart;
+    double wall = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    Result r;
+    r.test = "convert";
+    r.kernel = cu8::kernelNames[kernel];
+    r.sampleRate = 0;
+    r.blockSize = blockSize;
+    r.samples = blocks * (blockSize / 2);
+    r.nsPerSample = wall * 1e9 / (double)r.samples;
+    r.msps = (double)r.samples / wall / 1e6;
+    r.mspsPerCore = (double)r.samples / std::max<double>(cpu, 1e-9) / 1e6;
+    r.allocs = allocCount - allocs;
+    return r;
+}
+
+// Conversion with the ADC histograms counted tile by tile, compare against the bare kernel
+static Result benchConvertStats(cu8::Kernel kernel, int blockSize, uint64_t totalSamples) {
+    cu8::convert_t convert = cu8::get(kernel);
+    AdcStats adcStats;
+    std::vector<uint8_t> in(blockSize);
+    std::vector<float> out(blockSize);
+    for (int i = 0; i < blockSize; i++) { in[i] = rand(); }
+
+    uint64_t blocks = std::max<uint64_t>(totalSamples / (blockSize / 2), 1);
+    uint64_t allocs = allocCount;
+    auto start = std::chrono::steady_clock::now();
+    double cpuStart = cpuSeconds();
+    for (uint64_t i = 0; i < blocks; i++) {
+        adcStats.process(in.data(), out.data(), blockSize, convert);
+    }
+    double cpu = cpuSeconds() - cpuStart;
+    double wall = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    Result r;
+    r.test = "convert_stats";
+    r.kernel = cu8::kernelNames[kernel];
+    r.sampleRate = 0;
+    r.blockSize = blockSize;
+    r.samples = blocks * (blockSize / 2);
+    r.nsPerSample = wall * 1e9 / (double)r.samples;
+    r.msps = (double)r.samples / wall / 1e6;
+    r.mspsPerCore = (double)r.samples / std::max<double>(cpu, 1e-9) / 1e6;
+    r.allocs = allocCount - allocs;
+    return r;
+}
+
+// Native integer packing for raw sinks, kernel is the output format
+static Result benchPack(bool cs16, int blockSize, uint64_t totalSamples) {
+    std::vector<uint8_t> in(blockSize);
+    std::vector<int8_t> out8(blockSize);
+    std::vector<int16_t> out16(blockSize);
+    for (int i = 0; i < blockSize; i++) { in[i] = rand(); }
+
+    uint64_t blocks = std::max<uint64_t>(totalSamples / (blockSize / 2), 1);
+    uint64_t allocs = allocCount;
+    auto start = std::chrono::steady_clock::now();
+    double cpuStart = cpuSeconds();
+    for (uint64_t i = 0; i < blocks; i++) {
+        if (cs16) {
+            RawTap::packCS16(in.data(), out16.data(), blockSize);
+        }
+        else {
+            RawTap::packCS8(in.data(), out8.data(), blockSize);
+        }
+    }
+    double cpu = cpuSeconds() - cpuStart;
+    double wall = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    Result r;
+    r.test = "pack";
+    r.kernel = cs16 ? "cs16" : "cs8";
+    r.sampleRate = 0;
+    r.blockSize = blockSize;
+    r.samples = blocks * (blockSize / 2);
+    r.nsPerSample = wall * 1e9 / (double)r.samples;
+    r.msps = (double)r.samples / wall / 1e6;
+    r.mspsPerCore = (double)r.samples / std::max<double>(cpu, 1e-9) / 1e6;
+    r.allocs = allocCount - allocs;
+    return r;
+}
+
+// Halfband decimation chain on already converted samples, kernel holds the ratio
+static Result benchDecimate(int stages, int blockSize, uint64_t totalSamples) {
+    int count = blockSize / 2;
+    Decimator decim;
+    decim.init(stages, count);
+    std::vector<float> in(blockSize);
+    std::vector<float> work(blockSize);
+    for (int i = 0; i < blockSize; i++) { in[i] = (float)rand() / (float)RAND_MAX - 0.5f; }
+
+    uint64_t blocks = std::max<uint64_t>(totalSamples / count, 1);
+    uint64_t allocs = allocCount;
+    auto start = std::chrono::steady_clock::now();
+    double cpuStart = cpuSeconds();
+    for (uint64_t i = 0; i < blocks; i++) {
+        memcpy(work.data(), in.data(), blockSize * sizeof(float));
+        decim.process(work.data(), count);
+    }
+    double cpu = cpuSeconds() - cpuStart;
+    double wall = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    Result r;
+    r.test = "decimate";
+    r.kernel = "/" + std::to_string(1 << stages);
+    r.sampleRate = 0;
+    r.blockSize = blockSize;
+    r.samples = blocks * count;
+    r.nsPerSample = wall * 1e9 / (double)r.samples;
+    r.msps = (double)r.samples / wall / 1e6;
+    r.mspsPerCore = (double)r.samples / std::max<double>(cpu, 1e-9) / 1e6;
+    r.allocs = allocCount - allocs;
+    return r;
+}
+
+// Full path as in the module: producer thread plays the libusb callback, the converter thread pops,
+// converts and swaps, and a reader thread consumes the stream like the SDR++ signal path would
+static Result benchPipeline(cu8::Kernel kernel, double sampleRate, int blockSize, uint64_t totalSamples) {
+    cu8::convert_t convert = cu8::get(kernel);
+    dsp::stream<dsp::complex_t> stream;
+    SPSCRing ring;
+    ring.init(64, blockSize);
+
+    std::vector<uint8_t> usbBuf(blockSize);
+    for (int i = 0; i < blockSize; i++) { usbBuf[i] = rand(); }
+    uint64_t blocks = std::max<uint64_t>(totalSamples / (blockSize / 2), 1);
+
+    std::atomic<uint64_t> received = 0;
+    std::thread reader([&]() {
+        while (true) {
+            int count = stream.read();
+            if (count < 0) { break; }
+            received += count;
+            stream.flush();
+        }
+    });
+
+    std::thread converter([&]() {
+        int len;
+        while (true) {
+            uint8_t* buf = ring.pop(len);
+            if (!buf) { break; }
+            convert(buf, (float*)stream.writeBuf, len);
+            ring.release();
+            if (!stream.swap(len / 2)) { break; }
+        }
+    });
+
+    uint64_t allocs = allocCount;
+    auto start = std::chrono::steady_clock::now();
+    double cpuStart = cpuSeconds();
+
+    // The benchmark wants every block through, so wait instead of dropping like the usb thread would
+    for (uint64_t i = 0; i < blocks; i++) {
+        while (!ring.push(usbBuf.data(), blockSize)) { std::this_thread::yield(); }
+    }
+    while (received < blocks * (blockSize / 2)) { std::this_thread::yield(); }
+
+    double cpu = cpuSeconds() - cpuStart;
+    double wall = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    uint64_t usedAllocs = allocCount - allocs;
+
+    ring.stop();
+    stream.stopWriter();
+    converter.join();
+    stream.stopReader();
+    reader.join();
+
+    Result r;
+    r.test = "pipeline";
+    r.kernel = cu8::kernelNames[kernel];
+    r.sampleRate = sampleRate;
+    r.blockSize = blockSize;
+    r.samples = blocks * (blockSize / 2);
+    r.nsPerSample = wall * 1e9 / (double)r.samples;
+    r.msps = (double)r.samples / wall / 1e6;
+    r.mspsPerCore = (double)r.samples / std::max<double>(cpu, 1e-9) / 1e6;
+    r.allocs = usedAllocs;
+    return r;
+}
+
+int main(int argc, char* argv[]) {
+    double seconds = 1.0;
+    for (int i = 1; i < argc; i++) {
+        if (!strcmp(argv[i], "--csv")) {
+            csv = true;
+        }
+        else if (!strcmp(argv[i], "--seconds") && i + 1 < argc) {
+            seconds = atof(argv[++i]);
+        }
+        else {
+            fprintf(stderr, "Usage: %s [--csv] [--seconds N]\n", argv[0]);
+            fprintf(stderr, "  --seconds N   Amount of signal (at each sample rate) pushed through each test\n");
+            return 1;
+        }
+    }
+
+    if (csv) {
+        printf("test,kernel,sample_rate,block_size,samples,ns_per_sample,msps,msps_per_core,allocs\n");
+    }
+
+    cu8::Kernel best = cu8::best();
+    for (int k = 0; k < cu8::_KERNEL_COUNT; k++) {
+        if (!cu8::exact((cu8::Kernel)k)) { continue; }
+        for (int blockSize : { 512, 16384, 262144 }) {
+            print(benchConvert((cu8::Kernel)k, blockSize, (uint64_t)(3200000 * seconds)));
+            print(benchConvertStats((cu8::Kernel)k, blockSize, (uint64_t)(3200000 * seconds)));
+        }
+    }
+
+    for (bool cs16 : { false, true }) {
+        print(benchPack(cs16, 16384, (uint64_t)(3200000 * seconds)));
+    }
+
+    for (int stages = 1; stages <= DECIM_MAX_STAGES; stages++) {
+        print(benchDecimate(stages, 16384, (uint64_t)(3200000 * seconds)));
+    }
+
+    for (int i = 0; i < (int)SAMPLE_RATE_COUNT; i++) {
+        for (int p = 0; p < BUFFER_PROFILE_CUSTOM; p++) {
+            int blockSize = bufferProfileTransferSize(p, sampleRates[i]);
+            print(benchPipeline(best, sampleRates[i], blockSize, (uint64_t)(sampleRates[i] * seconds)));
+        }
+    }
+
+    return 0;
+}
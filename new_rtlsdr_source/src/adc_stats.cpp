@@ -0,0 +1,92 @@
+#include "adc_stats.h"
+#include <string.h>
+#include <math.h>
+#include <chrono>
+
+void AdcStats::reset() {
+    memset(hist, 0, sizeof(hist));
+    power = -100.0;
+    clipping = 0.0;
+    blocks = 0;
+    clippedSamples = 0;
+    std::lock_guard<std::mutex> lck(mtx);
+    published = {};
+}
+
+void AdcStats::count(const uint8_t* in, size_t bytes) {
+    uint32_t* hi0 = hist[0];
+    uint32_t* hq0 = hist[1];
+    uint32_t* hi1 = hist[2];
+    uint32_t* hq1 = hist[3];
+    size_t i = 0;
+    for (; i + 8 <= bytes; i += 8) {
+        hi0[in[i]]++;
+        hq0[in[i + 1]]++;
+        hi1[in[i + 2]]++;
+        hq1[in[i + 3]]++;
+        hi0[in[i + 4]]++;
+        hq0[in[i + 5]]++;
+        hi1[in[i + 6]]++;
+        hq1[in[i + 7]]++;
+    }
+    for (; i + 2 <= bytes; i += 2) {
+        hi0[in[i]]++;
+        hq0[in[i + 1]]++;
+    }
+}
+
+// Shannon entropy in bits of a code histogram
+static double entropy(const uint32_t* h, uint32_t total) {
+    if (!total) { return 0.0; }
+    double e = 0.0;
+    for (int v = 0; v < 256; v++) {
+        if (!h[v]) { continue; }
+        double p = (double)h[v] / (double)total;
+        e -= p * log2(p);
+    }
+    return e;
+}
+
+void AdcStats::endBlock(uint32_t samples) {
+    if (!samples) { return; }
+
+    RTLSDRAdcStats st;
+    double sumI = 0.0, sumQ = 0.0, sqI = 0.0, sqQ = 0.0;
+    for (int v = 0; v < 256; v++) {
+        st.histI[v] = hist[0][v] + hist[2][v];
+        st.histQ[v] = hist[1][v] + hist[3][v];
+        double d = (double)v - 127.5;
+        sumI += (double)st.histI[v] * v;
+        sumQ += (double)st.histQ[v] * v;
+        sqI += (double)st.histI[v] * d * d;
+        sqQ += (double)st.histQ[v] * d * d;
+    }
+    memset(hist, 0, sizeof(hist));
+
+    uint32_t clipI = st.histI[0] + st.histI[255];
+    uint32_t clipQ = st.histQ[0] + st.histQ[255];
+    blocks++;
+    clippedSamples += clipI + clipQ;
+
+    st.samples = samples;
+    st.clipI = (double)clipI / (double)samples;
+    st.clipQ = (double)clipQ / (double)samples;
+    st.meanI = sumI / (double)samples;
+    st.meanQ = sumQ / (double)samples;
+    st.rms = 10.0 * log10((sqI + sqQ) / ((double)samples * 127.5 * 127.5) + 1e-12);
+    st.effectiveBits = 0.5 * (entropy(st.histI, samples) + entropy(st.histQ, samples));
+    st.blocks = blocks;
+    st.clippedSamples = clippedSamples;
+    st.time = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::system_clock::now().time_since_epoch()).count();
+
+    power = st.rms;
+    clipping = (double)(clipI + clipQ) / (2.0 * (double)samples);
+
+    std::unique_lock<std::mutex> lck(mtx, std::try_to_lock);
+    if (lck.owns_lock()) { published = st; }
+}
+
+RTLSDRAdcStats AdcStats::get() {
+    std::lock_guard<std::mutex> lck(mtx);
+    return published;
+}
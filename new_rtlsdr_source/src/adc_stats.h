@@ -0,0 +1,51 @@
+#pragma once
+#include <stdint.h>
+#include <stddef.h>
+#include <mutex>
+#include "rtlsdr_interface.h"
+
+// Conversion is done in tiles of this many bytes, each tile gets counted right after while it's still
+// in L1, so the usb buffer is only read from memory once
+#define ADC_STATS_TILE  4096
+
+// 256 bin histograms of the raw I and Q bytes of every block, with clipping, DC, RMS and effective bits
+// derived from them. The converter thread never waits for readers, a block whose stats can't be
+// published right away is skipped.
+class AdcStats {
+public:
+    void reset();
+
+    // Converter thread. conv(in, out, bytes) is called tile by tile, everything it gets is counted.
+    template <class F>
+    void process(const uint8_t* in, float* out, int bytes, F conv) {
+        for (int i = 0; i < bytes; i += ADC_STATS_TILE) {
+            int n = (bytes - i < ADC_STATS_TILE) ? bytes - i : ADC_STATS_TILE;
+            conv(&in[i], &out[i], n);
+            count(&in[i], n);
+        }
+        endBlock(bytes / 2);
+    }
+
+    // Stats of the last block
+    RTLSDRAdcStats get();
+
+    // Counts bytes into the block histograms, even length and I first
+    void count(const uint8_t* in, size_t bytes);
+    void endBlock(uint32_t samples);
+
+    // Last block, converter thread only
+    double getPower() { return power; }
+    double getClipping() { return clipping; }
+
+private:
+    // Two copies per channel so consecutive increments of the same bin don't wait on each other
+    uint32_t hist[4][256] = {};
+
+    double power = -100.0;
+    double clipping = 0.0;
+    uint64_t blocks = 0;
+    uint64_t clippedSamples = 0;
+
+    std::mutex mtx;
+    RTLSDRAdcStats published = {};
+};
@@ -0,0 +1,105 @@
+#include "buffer_pool.h"
+#include <string.h>
+#include <new>
+#include <utils/flog.h>
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <sys/mman.h>
+#endif
+
+BufferPool::~BufferPool() {
+    release();
+}
+
+bool BufferPool::reserve(size_t size, bool hugePages, bool lock) {
+    if (base && size <= this->size && hugePages == wantHuge && lock == wantLock) {
+        reset();
+        return true;
+    }
+    release();
+    wantHuge = hugePages;
+    wantLock = lock;
+
+    // Whole huge pages, even when they end up as normal ones
+    size_t bytes = (size + BUFFER_POOL_HUGE_PAGE - 1) / BUFFER_POOL_HUGE_PAGE * BUFFER_POOL_HUGE_PAGE;
+
+#ifdef _WIN32
+    base = (uint8_t*)VirtualAlloc(NULL, bytes, MEM_COMMIT | MEM_RESERVE, PAGE_READWRITE);
+    isMapped = (base != NULL);
+#else
+#ifdef MAP_HUGETLB
+    if (hugePages) {
+        void* ptr = mmap(NULL, bytes, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+        if (ptr != MAP_FAILED) {
+            base = (uint8_t*)ptr;
+            huge = true;
+        }
+    }
+#endif
+    if (!base) {
+        void* ptr = mmap(NULL, bytes, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+        if (ptr != MAP_FAILED) { base = (uint8_t*)ptr; }
+#ifdef MADV_HUGEPAGE
+        // No reserved huge pages, transparent ones are the next best thing
+        if (base && hugePages) { huge = !madvise(base, bytes, MADV_HUGEPAGE); }
+#endif
+    }
+    isMapped = (base != NULL);
+#endif
+
+    if (!base) {
+        base = (uint8_t*)::operator new(bytes, std::align_val_t(BUFFER_POOL_ALIGN), std::nothrow);
+        if (!base) {
+            flog::error("Could not allocate a {0} byte buffer pool", bytes);
+            return false;
+        }
+    }
+    this->size = bytes;
+
+    if (lock) {
+#ifdef _WIN32
+        locked = isMapped && VirtualLock(base, bytes);
+#else
+        locked = !mlock(base, bytes);
+#endif
+        if (!locked) { flog::warn("Could not lock the {0} byte buffer pool in memory, check the memlock limit", bytes); }
+    }
+
+    // Fault every page in now rather than on the first samples
+    memset(base, 0, bytes);
+
+    reset();
+    flog::info("Buffer pool: {0} bytes{1}{2}", bytes, huge ? ", huge pages" : "", locked ? ", locked" : "");
+    return true;
+}
+
+void BufferPool::release() {
+    if (!base) { return; }
+#ifdef _WIN32
+    if (locked) { VirtualUnlock(base, size); }
+    if (isMapped) { VirtualFree(base, 0, MEM_RELEASE); }
+#else
+    if (locked) { munlock(base, size); }
+    if (isMapped) { munmap(base, size); }
+#endif
+    if (!isMapped) { ::operator delete(base, std::align_val_t(BUFFER_POOL_ALIGN)); }
+    base = NULL;
+    size = 0;
+    huge = false;
+    locked = false;
+    isMapped = false;
+    used = 0;
+}
+
+void BufferPool::reset() {
+    used = 0;
+}
+
+uint8_t* BufferPool::take(size_t bytes) {
+    size_t off = (used + BUFFER_POOL_ALIGN - 1) / BUFFER_POOL_ALIGN * BUFFER_POOL_ALIGN;
+    if (!base || off + bytes > size) { return NULL; }
+    used = off + bytes;
+    if (used > highWater) { highWater = used.load(); }
+    return &base[off];
+}
@@ -0,0 +1,45 @@
+#pragma once
+#include <stdint.h>
+#include <stddef.h>
+#include <atomic>
+
+// Every buffer handed out starts on its own cache line
+#define BUFFER_POOL_ALIGN       64
+#define BUFFER_POOL_HUGE_PAGE   (2 * 1024 * 1024)
+
+// One preallocated region the streaming buffers are carved out of. It's touched right after allocation
+// and kept across start/stop, so neither starting the stream nor running it page faults or goes through
+// the allocator. Optionally backed by huge pages and locked in memory.
+class BufferPool {
+public:
+    ~BufferPool();
+
+    // Makes sure at least size bytes are there, only reallocates when growing or when the flags changed.
+    // Nothing taken from the pool may be in use.
+    bool reserve(size_t size, bool hugePages, bool lock);
+    void release();
+
+    // Forgets everything taken so far
+    void reset();
+
+    // NULL if the pool is exhausted
+    uint8_t* take(size_t bytes);
+
+    size_t getSize() { return size; }
+    size_t getUsed() { return used; }
+    size_t getHighWater() { return highWater; }
+    bool isHuge() { return huge; }
+    bool isLocked() { return locked; }
+
+private:
+    uint8_t* base = NULL;
+    size_t size = 0;
+    bool wantHuge = false;
+    bool wantLock = false;
+    bool huge = false;
+    bool locked = false;
+    bool isMapped = false;
+
+    std::atomic<size_t> used = 0;
+    std::atomic<size_t> highWater = 0;
+};
@@ -0,0 +1,26 @@
+#pragma once
+#include <math.h>
+#include <algorithm>
+
+enum BufferProfile {
+    BUFFER_PROFILE_LOW_LATENCY,
+    BUFFER_PROFILE_BALANCED,
+    BUFFER_PROFILE_MAX_THROUGHPUT,
+    BUFFER_PROFILE_CUSTOM
+};
+
+// Duration of one usb transfer and number of transfers librtlsdr keeps in flight,
+// balanced is what the module always used (sampleRate / 200 bytes, librtlsdr's default count)
+const double bufferProfileBlockTime[] = { 0.001, 0.0025, 0.040 };
+const int bufferProfileCount[] = { 32, 15, 8 };
+
+// librtlsdr wants transfer sizes in multiples of 512 bytes
+#define RTL_TRANSFER_ALIGN      512
+#define RTL_MAX_TRANSFER_SIZE   (256 * 1024)
+#define RTL_MAX_BUFFER_COUNT    128
+
+// Bytes per usb transfer for a (non custom) profile at the given sample rate
+inline int bufferProfileTransferSize(int profile, double sampleRate) {
+    int bytes = (int)round(sampleRate * 2.0 * bufferProfileBlockTime[profile] / RTL_TRANSFER_ALIGN) * RTL_TRANSFER_ALIGN;
+    return std::clamp<int>(bytes, RTL_TRANSFER_ALIGN, RTL_MAX_TRANSFER_SIZE);
+}
@@ -0,0 +1,152 @@
+#include "clock_model.h"
+#include <math.h>
+#include <chrono>
+#include <algorithm>
+#include <utils/flog.h>
+
+#define CLOCK_MODEL_PI      3.14159265358979323846
+
+void ClockModel::reset(double nominalRate, int blockSamples) {
+    this->nominalRate = nominalRate;
+    blockTime = (double)blockSamples / nominalRate;
+    confirmBlocks = std::max<int>(3, (int)ceil(CLOCK_MODEL_JUMP_CONFIRM / blockTime));
+    primed = false;
+    tracking = false;
+    outliers = 0;
+    jitterSq = 0.0;
+    discontinuities = 0;
+    loggedDiscontinuities = 0;
+    lastJump = 0;
+    lastJumpIndex = 0;
+
+    int64_t wall = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::system_clock::now().time_since_epoch()).count();
+    std::lock_guard<std::mutex> lck(mtx);
+    published = {};
+    published.nominalRate = nominalRate;
+    published.wallOffset = wall - now();
+    blocks.clear();
+}
+
+void ClockModel::setBandwidth(double bw) {
+    double w = 2.0 * CLOCK_MODEL_PI * bw * blockTime;
+    b = sqrt(2.0) * w;
+    c = w * w;
+}
+
+bool ClockModel::block(BlockStamp& stamp, uint32_t samples) {
+    uint64_t end = stamp.index + samples;
+    bool jump = false;
+
+    if (!primed) {
+        // The callback marks the end of its block
+        primed = true;
+        origin = stamp.hostTime;
+        refTime = 0.0;
+        period = 1e9 / nominalRate;
+        setBandwidth(CLOCK_MODEL_LOCK_BW);
+    }
+    else if (stamp.index != nextIndex) {
+        // Samples went missing (or came twice) before they got here, start over from this block
+        lastJump = (int64_t)(stamp.index - nextIndex);
+        lastJumpIndex = stamp.index;
+        refTime = (double)(stamp.hostTime - origin);
+        outliers = 0;
+        discontinuities++;
+        jump = true;
+    }
+    else {
+        double t = (double)(stamp.hostTime - origin);
+        double pred = refTime + (double)samples * period;
+        double e = t - pred;
+
+        if (fabs(e) < CLOCK_MODEL_JUMP_MS * 1e6) {
+            outliers = 0;
+            refTime = pred + b * e;
+            period += c * e / (double)samples;
+            jitterSq += 0.01 * (e * e - jitterSq);
+        }
+        else {
+            // Coast on the model, latency only ever adds so the smallest offset of the run is the jump
+            if (outliers && (e > 0) != (outlierMin > 0)) { outliers = 0; }
+            if (!outliers || fabs(e) < fabs(outlierMin)) { outlierMin = e; }
+            outliers++;
+            refTime = pred;
+            if (outliers >= confirmBlocks) {
+                refTime += outlierMin;
+                outliers = 0;
+                if (tracking) {
+                    lastJump = (int64_t)round(outlierMin / period);
+                    lastJumpIndex = stamp.index;
+                    discontinuities++;
+                    jump = true;
+                }
+            }
+        }
+
+        if (!tracking && t > CLOCK_MODEL_LOCK_TIME * 1e9) {
+            tracking = true;
+            setBandwidth(CLOCK_MODEL_TRACK_BW);
+        }
+    }
+
+    nextIndex = end;
+    stamp.modelTime = origin + (int64_t)(refTime - (double)samples * period);
+    publish();
+    return jump;
+}
+
+void ClockModel::publish() {
+    // Never wait on a reader, the next block publishes again
+    std::unique_lock<std::mutex> lck(mtx, std::try_to_lock);
+    if (!lck.owns_lock()) { return; }
+    published.rate = 1e9 / period;
+    published.ppm = (published.rate / nominalRate - 1.0) * 1e6;
+    published.jitter = sqrt(jitterSq) / 1000.0;
+    published.anchorIndex = nextIndex;
+    published.anchorTime = origin + (int64_t)refTime;
+    published.discontinuities = discontinuities;
+    published.lastJump = lastJump;
+    published.lastJumpIndex = lastJumpIndex;
+    published.locked = tracking;
+}
+
+void ClockModel::stream(const BlockStamp& stamp, uint64_t streamIndex) {
+    RTLSDRBlockTime bt;
+    bt.sampleIndex = stamp.index;
+    bt.streamIndex = streamIndex;
+    bt.hostTime = stamp.hostTime;
+    bt.modelTime = stamp.modelTime;
+
+    std::lock_guard<std::mutex> lck(mtx);
+    blocks.push_back(bt);
+    if (blocks.size() > CLOCK_MODEL_HISTORY) { blocks.pop_front(); }
+}
+
+int64_t ClockModel::timeAt(uint64_t index) {
+    std::lock_guard<std::mutex> lck(mtx);
+    if (published.rate <= 0.0) { return 0; }
+    return published.anchorTime + (int64_t)round((double)(int64_t)(index - published.anchorIndex) * 1e9 / published.rate);
+}
+
+RTLSDRClockState ClockModel::get() {
+    std::lock_guard<std::mutex> lck(mtx);
+    return published;
+}
+
+std::vector<RTLSDRBlockTime> ClockModel::getBlocks() {
+    std::lock_guard<std::mutex> lck(mtx);
+    return std::vector<RTLSDRBlockTime>(blocks.begin(), blocks.end());
+}
+
+void ClockModel::log(const std::string& name) {
+    uint64_t d = discontinuities;
+    if (d == loggedDiscontinuities) { return; }
+    loggedDiscontinuities = d;
+    RTLSDRClockState st = get();
+    flog::warn("RTLSDRSourceModule '{0}': Sample clock discontinuity at sample {1} ({2} samples), {3} so far",
+               name, st.lastJumpIndex, st.lastJump, st.discontinuities);
+}
+
+int64_t ClockModel::now() {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
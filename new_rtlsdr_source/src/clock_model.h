@@ -0,0 +1,78 @@
+#pragma once
+#include <stdint.h>
+#include <atomic>
+#include <deque>
+#include <mutex>
+#include <vector>
+#include <string>
+#include "spsc_ring.h"
+#include "rtlsdr_interface.h"
+
+// Loop bandwidth while locking and once locked, Hz
+#define CLOCK_MODEL_LOCK_BW         1.0
+#define CLOCK_MODEL_TRACK_BW        0.02
+#define CLOCK_MODEL_LOCK_TIME       5.0
+
+// A callback this far off the model is an outlier, it's a discontinuity once the model stays that far
+// off for CLOCK_MODEL_JUMP_CONFIRM seconds (a single late callback is followed by a burst that catches up)
+#define CLOCK_MODEL_JUMP_MS         10.0
+#define CLOCK_MODEL_JUMP_CONFIRM    0.1
+
+#define CLOCK_MODEL_HISTORY         256
+
+// Relates the sample index to the host's monotonic clock. Callback times are filtered with a second
+// order delay locked loop, which gives a smooth time for every sample and the actual ADC rate against
+// the host clock. Callbacks carry the usb latency, which is near constant and ends up in the offset.
+class ClockModel {
+public:
+    // blockSamples is the usual block size, the loop gains are derived from it
+    void reset(double nominalRate, int blockSamples);
+
+    // Usb thread, stamp has index and hostTime set, modelTime gets filled in.
+    // Returns true if the block doesn't line up with the model anymore.
+    bool block(BlockStamp& stamp, uint32_t samples);
+
+    // Converter thread, once the block's first sample went to the stream at streamIndex
+    void stream(const BlockStamp& stamp, uint64_t streamIndex);
+
+    // ns on the steady clock for a sample index, from the last published model
+    int64_t timeAt(uint64_t index);
+
+    RTLSDRClockState get();
+    std::vector<RTLSDRBlockTime> getBlocks();
+
+    // Called from the converter thread, logs discontinuities not logged yet
+    void log(const std::string& name);
+
+    static int64_t now();
+
+private:
+    void setBandwidth(double bw);
+    void publish();
+
+    double nominalRate = 1.0;
+    double blockTime = 0.0;
+    int confirmBlocks = 1;
+
+    // Usb thread only, times relative to origin
+    bool primed = false;
+    int64_t origin = 0;
+    uint64_t nextIndex = 0;
+    double refTime = 0.0;       // ns, model time of nextIndex
+    double period = 0.0;        // ns per sample
+    double b = 0.0;
+    double c = 0.0;
+    bool tracking = false;
+    double jitterSq = 0.0;
+    int outliers = 0;
+    double outlierMin = 0.0;
+
+    std::atomic<uint64_t> discontinuities = 0;
+    std::atomic<uint64_t> loggedDiscontinuities = 0;
+    int64_t lastJump = 0;
+    uint64_t lastJumpIndex = 0;
+
+    std::mutex mtx;
+    RTLSDRClockState published = {};
+    std::deque<RTLSDRBlockTime> blocks;
+};
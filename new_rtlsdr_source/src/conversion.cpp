@@ -0,0 +1,237 @@
+#include "conversion.h"
+#include <string.h>
+
+#if defined(__x86_64__) || defined(_M_X64) || defined(__i386__) || defined(_M_IX86)
+#define CU8_X86
+#include <immintrin.h>
+#ifdef _MSC_VER
+#include <intrin.h>
+#define CU8_TARGET(t)
+#else
+#define CU8_TARGET(t) __attribute__((target(t)))
+#endif
+#endif
+
+#if defined(__ARM_NEON) || defined(__ARM_NEON__) || defined(_M_ARM64)
+#define CU8_NEON
+#include <arm_neon.h>
+#endif
+
+namespace cu8 {
+    const char* kernelNames[_KERNEL_COUNT] = {
+        "Scalar",
+        "LUT",
+        "SSE2",
+        "AVX2",
+        "NEON"
+    };
+
+    // The reference does (x - 127.4) in double then rounds to float, dividing by 128 is exact.
+    // Splitting 127.4 into a float high part and the float rounded remainder gives the same
+    // floats with single precision math: (x - OFFSET_HI) is exact and the second subtraction
+    // does the only rounding. exact() checks this on every kernel anyway.
+    static const float OFFSET_HI = 127.4f;
+    static const float OFFSET_LO = (float)(127.4 - (double)127.4f);
+    static const float SCALE = 1.0f / 128.0f;
+
+    static float table[256];
+    static bool tableReady = false;
+
+    const float* lut() {
+        if (!tableReady) {
+            for (int i = 0; i < 256; i++) { table[i] = reference(i); }
+            tableReady = true;
+        }
+        return table;
+    }
+
+    static void convertScalar(const uint8_t* in, float* out, size_t count) {
+        for (size_t i = 0; i < count; i++) {
+            out[i] = ((float)in[i] - 127.4) / 128.0f;
+        }
+    }
+
+    static void convertLUT(const uint8_t* in, float* out, size_t count) {
+        const float* t = table;
+        size_t i = 0;
+        for (; i + 4 <= count; i += 4) {
+            out[i] = t[in[i]];
+            out[i + 1] = t[in[i + 1]];
+            out[i + 2] = t[in[i + 2]];
+            out[i + 3] = t[in[i + 3]];
+        }
+        for (; i < count; i++) { out[i] = t[in[i]]; }
+    }
+
+#ifdef CU8_X86
+    CU8_TARGET("sse2")
+    static inline __m128 sse2Map(__m128i v) {
+        __m128 f = _mm_cvtepi32_ps(v);
+        f = _mm_sub_ps(f, _mm_set1_ps(OFFSET_HI));
+        f = _mm_sub_ps(f, _mm_set1_ps(OFFSET_LO));
+        return _mm_mul_ps(f, _mm_set1_ps(SCALE));
+    }
+
+    CU8_TARGET("sse2")
+    static void convertSSE2(const uint8_t* in, float* out, size_t count) {
+        const __m128i zero = _mm_setzero_si128();
+        size_t i = 0;
+        for (; i + 16 <= count; i += 16) {
+            __m128i b = _mm_loadu_si128((const __m128i*)&in[i]);
+            __m128i lo = _mm_unpacklo_epi8(b, zero);
+            __m128i hi = _mm_unpackhi_epi8(b, zero);
+            _mm_storeu_ps(&out[i], sse2Map(_mm_unpacklo_epi16(lo, zero)));
+            _mm_storeu_ps(&out[i + 4], sse2Map(_mm_unpackhi_epi16(lo, zero)));
+            _mm_storeu_ps(&out[i + 8], sse2Map(_mm_unpacklo_epi16(hi, zero)));
+            _mm_storeu_ps(&out[i + 12], sse2Map(_mm_unpackhi_epi16(hi, zero)));
+        }
+        convertLUT(&in[i], &out[i], count - i);
+    }
+
+    CU8_TARGET("avx2")
+    static inline __m256 avx2Map(const uint8_t* in) {
+        __m256 f = _mm256_cvtepi32_ps(_mm256_cvtepu8_epi32(_mm_loadl_epi64((const __m128i*)in)));
+        f = _mm256_sub_ps(f, _mm256_set1_ps(OFFSET_HI));
+        f = _mm256_sub_ps(f, _mm256_set1_ps(OFFSET_LO));
+        return _mm256_mul_ps(f, _mm256_set1_ps(SCALE));
+    }
+
+    CU8_TARGET("avx2")
+    static void convertAVX2(const uint8_t* in, float* out, size_t count) {
+        size_t i = 0;
+        for (; i + 32 <= count; i += 32) {
+            _mm256_storeu_ps(&out[i], avx2Map(&in[i]));
+            _mm256_storeu_ps(&out[i + 8], avx2Map(&in[i + 8]));
+            _mm256_storeu_ps(&out[i + 16], avx2Map(&in[i + 16]));
+            _mm256_storeu_ps(&out[i + 24], avx2Map(&in[i + 24]));
+        }
+        convertLUT(&in[i], &out[i], count - i);
+    }
+
+    static bool cpuHasAVX2() {
+#ifdef _MSC_VER
+        int regs[4];
+        __cpuid(regs, 0);
+        if (regs[0] < 7) { return false; }
+        __cpuid(regs, 1);
+        bool osxsave = (regs[2] & (1 << 27)) != 0;
+        bool avx = (regs[2] & (1 << 28)) != 0;
+        if (!osxsave || !avx) { return false; }
+        if ((_xgetbv(0) & 6) != 6) { return false; }
+        __cpuidex(regs, 7, 0);
+        return (regs[1] & (1 << 5)) != 0;
+#else
+        __builtin_cpu_init();
+        return __builtin_cpu_supports("avx2");
+#endif
+    }
+
+    static bool cpuHasSSE2() {
+#if defined(__x86_64__) || defined(_M_X64)
+        return true;
+#elif defined(_MSC_VER)
+        int regs[4];
+        __cpuid(regs, 1);
+        return (regs[3] & (1 << 26)) != 0;
+#else
+        __builtin_cpu_init();
+        return __builtin_cpu_supports("sse2");
+#endif
+    }
+#endif
+
+#ifdef CU8_NEON
+    static inline float32x4_t neonMap(uint16x4_t v) {
+        float32x4_t f = vcvtq_f32_u32(vmovl_u16(v));
+        f = vsubq_f32(f, vdupq_n_f32(OFFSET_HI));
+        f = vsubq_f32(f, vdupq_n_f32(OFFSET_LO));
+        return vmulq_f32(f, vdupq_n_f32(SCALE));
+    }
+
+    static void convertNEON(const uint8_t* in, float* out, size_t count) {
+        size_t i = 0;
+        for (; i + 16 <= count; i += 16) {
+            uint8x16_t b = vld1q_u8(&in[i]);
+            uint16x8_t lo = vmovl_u8(vget_low_u8(b));
+            uint16x8_t hi = vmovl_u8(vget_high_u8(b));
+            vst1q_f32(&out[i], neonMap(vget_low_u16(lo)));
+            vst1q_f32(&out[i + 4], neonMap(vget_high_u16(lo)));
+            vst1q_f32(&out[i + 8], neonMap(vget_low_u16(hi)));
+            vst1q_f32(&out[i + 12], neonMap(vget_high_u16(hi)));
+        }
+        convertLUT(&in[i], &out[i], count - i);
+    }
+#endif
+
+    bool supported(Kernel kernel) {
+        switch (kernel) {
+        case KERNEL_SCALAR:
+        case KERNEL_LUT:
+            return true;
+#ifdef CU8_X86
+        case KERNEL_SSE2:
+            return cpuHasSSE2();
+        case KERNEL_AVX2:
+            return cpuHasAVX2();
+#endif
+#ifdef CU8_NEON
+        case KERNEL_NEON:
+            return true;
+#endif
+        default:
+            return false;
+        }
+    }
+
+    convert_t get(Kernel kernel) {
+        if (!supported(kernel)) { return nullptr; }
+
+        // The LUT is also used for the tail of every SIMD kernel
+        lut();
+
+        switch (kernel) {
+        case KERNEL_SCALAR:
+            return convertScalar;
+        case KERNEL_LUT:
+            return convertLUT;
+#ifdef CU8_X86
+        case KERNEL_SSE2:
+            return convertSSE2;
+        case KERNEL_AVX2:
+            return convertAVX2;
+#endif
+#ifdef CU8_NEON
+        case KERNEL_NEON:
+            return convertNEON;
+#endif
+        default:
+            return nullptr;
+        }
+    }
+
+    bool exact(Kernel kernel) {
+        convert_t convert = get(kernel);
+        if (!convert) { return false; }
+
+        // Each output only depends on its own input byte so this covers every case,
+        // the odd length and offset also run the remainder path of the SIMD kernels
+        uint8_t in[256 + 7];
+        float out[256 + 7];
+        for (int i = 0; i < 256 + 7; i++) { in[i] = (uint8_t)i; }
+        convert(&in[1], &out[1], 256 + 5);
+
+        for (int i = 1; i < 256 + 6; i++) {
+            float ref = reference(in[i]);
+            if (memcmp(&ref, &out[i], sizeof(float))) { return false; }
+        }
+        return true;
+    }
+
+    Kernel best() {
+        const Kernel order[] = { KERNEL_AVX2, KERNEL_NEON, KERNEL_SSE2, KERNEL_LUT };
+        for (Kernel k : order) {
+            if (exact(k)) { return k; }
+        }
+        return KERNEL_SCALAR;
+    }
+}
@@ -0,0 +1,42 @@
+#pragma once
+#include <stdint.h>
+#include <stddef.h>
+
+// CU8 (unsigned 8bit IQ from the dongle) to interleaved float conversion kernels.
+// Every kernel must give the exact same floats as the original ((x - 127.4) / 128) mapping,
+// this is verified for all 256 input values before a kernel is allowed to run.
+namespace cu8 {
+    enum Kernel {
+        KERNEL_SCALAR,
+        KERNEL_LUT,
+        KERNEL_SSE2,
+        KERNEL_AVX2,
+        KERNEL_NEON,
+        _KERNEL_COUNT
+    };
+
+    extern const char* kernelNames[_KERNEL_COUNT];
+
+    // in: raw bytes from usb, out: interleaved re/im floats, count: number of bytes (2 per sample)
+    typedef void (*convert_t)(const uint8_t* in, float* out, size_t count);
+
+    // Reference mapping, this is what the module always did
+    inline float reference(uint8_t x) {
+        return ((float)x - 127.4) / 128.0f;
+    }
+
+    // Lookup table with the reference mapping of every byte value
+    const float* lut();
+
+    // True if the kernel was compiled in and the cpu can run it
+    bool supported(Kernel kernel);
+
+    // Runs the kernel on every possible byte value and compares against reference()
+    bool exact(Kernel kernel);
+
+    // nullptr if the kernel is not supported
+    convert_t get(Kernel kernel);
+
+    // Fastest supported kernel that passes exact()
+    Kernel best();
+}
@@ -0,0 +1,119 @@
+#include "decimator.h"
+#include <math.h>
+#include <string.h>
+#include <algorithm>
+
+#define DECIM_PI            3.14159265358979323846
+#define DECIM_KAISER_BETA   8.5
+
+// The early stages only have to protect what survives the later ones so they can be short,
+// the last stage sets the passband of the output and gets the long filter. With these every
+// ratio keeps aliases landing within +-0.4 of the output rate about 85 dB down.
+#define DECIM_EARLY_TAPS    6
+#define DECIM_LAST_TAPS     14
+
+// Floats accumulated at once
+#define DECIM_CHUNK         256
+
+static double bessel0(double x) {
+    double sum = 1.0, term = 1.0;
+    for (int k = 1; k < 32; k++) {
+        term *= (x / (2.0 * k)) * (x / (2.0 * k));
+        sum += term;
+    }
+    return sum;
+}
+
+void HalfbandStage::init(int taps, int maxInput) {
+    len = 4 * taps - 1;
+    hist = len - 1;
+
+    // Kaiser windowed sinc cut at a quarter of the input rate, only the odd offsets are non zero
+    coeffs.resize(taps);
+    double half = (len - 1) / 2.0;
+    double sum = 0.5;
+    for (int j = 0; j < taps; j++) {
+        int n = 2 * j + 1;
+        double r = n / half;
+        double w = bessel0(DECIM_KAISER_BETA * sqrt(1.0 - r * r)) / bessel0(DECIM_KAISER_BETA);
+        coeffs[j] = (float)(sin(DECIM_PI * n / 2.0) / (DECIM_PI * n) * w);
+        sum += 2.0 * coeffs[j];
+    }
+
+    // Unity gain at DC
+    for (float& c : coeffs) { c = (float)(c / sum); }
+    center = (float)(0.5 / sum);
+
+    buf.resize((size_t)(hist + maxInput) * 2);
+    side.resize((size_t)(hist + maxInput) * 2);
+    reset();
+}
+
+void HalfbandStage::reset() {
+    std::fill(buf.begin(), buf.end(), 0.0f);
+    phase = 0;
+}
+
+int HalfbandStage::process(const float* in, int count, float* out) {
+    memcpy(&buf[hist * 2], in, count * 2 * sizeof(float));
+
+    // Outputs are centered on buf[phase + len / 2 + 2m], all side taps land on the other phase
+    int total = hist + count;
+    int outCount = (total - len - phase) / 2 + 1;
+    if (total - len - phase < 0) { outCount = 0; }
+    int taps = coeffs.size();
+
+    if (outCount) {
+        // Split into the two polyphase branches so the tap loop runs on contiguous floats
+        int sideCount = outCount + 2 * taps - 1;
+        const float* base = &buf[phase * 2];
+        for (int k = 0; k < sideCount; k++) {
+            side[2 * k] = base[4 * k];
+            side[2 * k + 1] = base[4 * k + 1];
+        }
+
+        // Accumulate in chunks that stay in L1 while all taps are applied
+        const float* ctr = &buf[(phase + len / 2) * 2];
+        float acc[DECIM_CHUNK];
+        for (int m0 = 0; m0 < outCount; m0 += DECIM_CHUNK / 2) {
+            int n = std::min<int>(outCount - m0, DECIM_CHUNK / 2) * 2;
+            for (int f = 0; f < n; f += 2) {
+                acc[f] = center * ctr[2 * (m0 * 2 + f)];
+                acc[f + 1] = center * ctr[2 * (m0 * 2 + f) + 1];
+            }
+            for (int j = 0; j < taps; j++) {
+                float c = coeffs[j];
+                const float* lo = &side[(m0 + taps - 1 - j) * 2];
+                const float* hi = &side[(m0 + taps + j) * 2];
+                for (int f = 0; f < n; f++) {
+                    acc[f] += c * (lo[f] + hi[f]);
+                }
+            }
+            memcpy(&out[m0 * 2], acc, n * sizeof(float));
+        }
+    }
+
+    // Keep the tail as history and remember where the next output falls
+    memmove(&buf[0], &buf[count * 2], hist * 2 * sizeof(float));
+    phase = phase + 2 * outCount - count;
+    return outCount;
+}
+
+void Decimator::init(int stageCount, int maxInput) {
+    stages.clear();
+    stages.resize(stageCount);
+    for (int i = 0; i < stageCount; i++) {
+        stages[i].init((i == stageCount - 1) ? DECIM_LAST_TAPS : DECIM_EARLY_TAPS, maxInput >> i);
+    }
+}
+
+void Decimator::reset() {
+    for (auto& st : stages) { st.reset(); }
+}
+
+int Decimator::process(float* data, int count) {
+    for (auto& st : stages) {
+        count = st.process(data, count, data);
+    }
+    return count;
+}
@@ -0,0 +1,40 @@
+#pragma once
+#include <vector>
+
+#define DECIM_MAX_STAGES 6
+
+// Cascade of halfband decimate-by-2 filters on interleaved complex floats.
+// Every stage only computes the outputs it keeps and skips the zero taps of the halfband.
+class HalfbandStage {
+public:
+    // taps: number of non zero side taps, the filter is 4 * taps - 1 long
+    void init(int taps, int maxInput);
+    void reset();
+
+    // out may be the same array as in, returns the number of output samples
+    int process(const float* in, int count, float* out);
+
+private:
+    std::vector<float> coeffs;  // Side taps at offsets 1, 3, 5...
+    std::vector<float> buf;     // History followed by the current input
+    std::vector<float> side;    // Odd phase samples relative to the output centers
+    float center = 0.5f;
+    int len = 0;
+    int hist = 0;
+    int phase = 0;
+};
+
+class Decimator {
+public:
+    // stages: log2 of the decimation ratio, maxInput: largest block passed to process()
+    void init(int stages, int maxInput);
+    void reset();
+
+    // In place, returns the number of output samples
+    int process(float* data, int count);
+
+    int getStages() { return (int)stages.size(); }
+
+private:
+    std::vector<HalfbandStage> stages;
+};
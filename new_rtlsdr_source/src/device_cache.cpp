@@ -0,0 +1,88 @@
+#include "device_cache.h"
+
+void DeviceCache::load(const json& j) {
+    std::lock_guard<std::mutex> lck(mtx);
+    loaded = true;
+    strings.clear();
+    caps.clear();
+
+    if (j.contains("usbStrings") && j["usbStrings"].is_object()) {
+        for (auto& el : j["usbStrings"].items()) {
+            const json& e = el.value();
+            if (!e.contains("serial") || !e["serial"].is_string() || !e.contains("vid") || !e.contains("pid")) { continue; }
+            DeviceStrings s;
+            s.vid = e["vid"];
+            s.pid = e["pid"];
+            if (e.contains("manufacturer") && e["manufacturer"].is_string()) { s.manufacturer = e["manufacturer"]; }
+            if (e.contains("product") && e["product"].is_string()) { s.product = e["product"]; }
+            s.serial = e["serial"];
+            strings[el.key()] = s;
+        }
+    }
+
+    if (j.contains("caps") && j["caps"].is_object()) {
+        for (auto& el : j["caps"].items()) {
+            const json& e = el.value();
+            if (!e.contains("tuner") || !e.contains("gains") || !e["gains"].is_array()) { continue; }
+            DeviceCaps c;
+            c.tuner = e["tuner"];
+            for (const auto& g : e["gains"]) { c.gains.push_back(g); }
+            if (c.gains.empty()) { continue; }
+            caps[el.key()] = c;
+        }
+    }
+    dirty = false;
+}
+
+json DeviceCache::save() {
+    std::lock_guard<std::mutex> lck(mtx);
+    json j = json({});
+    j["usbStrings"] = json({});
+    for (const auto& [loc, s] : strings) {
+        j["usbStrings"][loc]["vid"] = s.vid;
+        j["usbStrings"][loc]["pid"] = s.pid;
+        j["usbStrings"][loc]["manufacturer"] = s.manufacturer;
+        j["usbStrings"][loc]["product"] = s.product;
+        j["usbStrings"][loc]["serial"] = s.serial;
+    }
+    j["caps"] = json({});
+    for (const auto& [key, c] : caps) {
+        j["caps"][key]["tuner"] = c.tuner;
+        j["caps"][key]["gains"] = c.gains;
+    }
+    dirty = false;
+    return j;
+}
+
+bool DeviceCache::getStrings(const std::string& location, uint16_t vid, uint16_t pid, DeviceStrings& strings) {
+    std::lock_guard<std::mutex> lck(mtx);
+    auto it = this->strings.find(location);
+    if (it == this->strings.end() || it->second.vid != vid || it->second.pid != pid) { return false; }
+    strings = it->second;
+    return true;
+}
+
+void DeviceCache::putStrings(const std::string& location, const DeviceStrings& strings) {
+    std::lock_guard<std::mutex> lck(mtx);
+    this->strings[location] = strings;
+    dirty = true;
+}
+
+void DeviceCache::dropStrings(const std::string& location) {
+    std::lock_guard<std::mutex> lck(mtx);
+    if (this->strings.erase(location)) { dirty = true; }
+}
+
+bool DeviceCache::getCaps(const std::string& key, DeviceCaps& caps) {
+    std::lock_guard<std::mutex> lck(mtx);
+    auto it = this->caps.find(key);
+    if (it == this->caps.end()) { return false; }
+    caps = it->second;
+    return true;
+}
+
+void DeviceCache::putCaps(const std::string& key, const DeviceCaps& caps) {
+    std::lock_guard<std::mutex> lck(mtx);
+    this->caps[key] = caps;
+    dirty = true;
+}
@@ -0,0 +1,49 @@
+#pragma once
+#include <stdint.h>
+#include <string>
+#include <vector>
+#include <map>
+#include <mutex>
+#include <config.h>
+
+struct DeviceStrings {
+    uint16_t vid = 0;
+    uint16_t pid = 0;
+    std::string manufacturer;
+    std::string product;
+    std::string serial;
+};
+
+struct DeviceCaps {
+    int tuner;
+    std::vector<int> gains;     // Tenths of dB, sorted
+};
+
+// What enumeration and device selection used to open every dongle for. USB strings are keyed by the port
+// the dongle is plugged into (known without opening it) and only trusted while the same vid/pid sits in
+// that port, hotplug events on the port drop the entry. Tuner type and gain table are keyed by model and
+// serial. Shared by all instances and persisted in the config.
+class DeviceCache {
+public:
+    void load(const json& j);
+    json save();
+    bool isLoaded() { return loaded; }
+
+    // True if something changed since the last save()
+    bool isDirty() { return dirty; }
+
+    // False if nothing is cached for the port or it was cached for another kind of dongle
+    bool getStrings(const std::string& location, uint16_t vid, uint16_t pid, DeviceStrings& strings);
+    void putStrings(const std::string& location, const DeviceStrings& strings);
+    void dropStrings(const std::string& location);
+
+    bool getCaps(const std::string& key, DeviceCaps& caps);
+    void putCaps(const std::string& key, const DeviceCaps& caps);
+
+private:
+    std::mutex mtx;
+    bool loaded = false;
+    bool dirty = false;
+    std::map<std::string, DeviceStrings> strings;
+    std::map<std::string, DeviceCaps> caps;
+};
@@ -0,0 +1,197 @@
+#include "device_executor.h"
+#include <utils/flog.h>
+
+const char* deviceCommandNames[DEV_CMD_COUNT] = {
+    "Open",
+    "Close",
+    "Init",
+    "Tune",
+    "PPM",
+    "Direct Sampling",
+    "IF Frequency",
+    "Sideband",
+    "Gain Mode",
+    "Gain",
+    "VGA Gain",
+    "Tuner Register",
+    "Bias T",
+    "Offset Tuning",
+    "RTL AGC",
+    "Module AGC",
+    "Flush",
+    "Telemetry"
+};
+
+DeviceExecutor::~DeviceExecutor() {
+    stop();
+}
+
+void DeviceExecutor::start() {
+    std::lock_guard<std::mutex> lck(mtx);
+    if (running) { return; }
+    running = true;
+    workerThread = std::thread(&DeviceExecutor::worker, this);
+}
+
+void DeviceExecutor::stop() {
+    close();
+    {
+        std::lock_guard<std::mutex> lck(mtx);
+        running = false;
+    }
+    cnd.notify_all();
+    if (workerThread.joinable()) { workerThread.join(); }
+}
+
+RTLDevice* DeviceExecutor::open(const std::function<RTLDevice*()>& opener) {
+    call(DEV_CMD_OPEN, [this, &opener](RTLDevice* d) {
+        delete d;
+        dev = opener();
+    });
+    return dev;
+}
+
+void DeviceExecutor::close() {
+    {
+        // Whatever is still queued was meant for this device
+        std::lock_guard<std::mutex> lck(mtx);
+        if (!running) { return; }
+        for (auto it = queue.begin(); it != queue.end();) {
+            if (it->done) {
+                it++;
+                continue;
+            }
+            dropped[it->type]++;
+            it = queue.erase(it);
+        }
+    }
+    call(DEV_CMD_CLOSE, [this](RTLDevice* d) {
+        delete d;
+        dev = NULL;
+    });
+}
+
+void DeviceExecutor::post(int type, const Command& cmd, int key) {
+    {
+        std::lock_guard<std::mutex> lck(mtx);
+        for (auto it = queue.begin(); it != queue.end(); it++) {
+            if (!it->done && it->type == type && it->key == key) {
+                // Goes to the back so it still runs after everything posted before it
+                coalesced[type]++;
+                queue.erase(it);
+                break;
+            }
+        }
+        queue.push_back(Entry { type, key, cmd, std::chrono::steady_clock::now(), NULL, NULL });
+    }
+    cnd.notify_all();
+}
+
+bool DeviceExecutor::call(int type, const Command& cmd) {
+    bool done = false;
+    bool ok = false;
+    Entry e { type, 0, cmd, std::chrono::steady_clock::now(), &done, &ok };
+
+    // Commands running on the executor can't wait for it
+    if (std::this_thread::get_id() == workerThread.get_id()) {
+        execute(e);
+        return ok;
+    }
+
+    std::unique_lock<std::mutex> lck(mtx);
+    if (!running) { return false; }
+    queue.push_back(e);
+    cnd.notify_all();
+    doneCnd.wait(lck, [&done]() { return done; });
+    return ok;
+}
+
+void DeviceExecutor::setIdle(const Command& cmd) {
+    std::lock_guard<std::mutex> lck(mtx);
+    idle = cmd;
+}
+
+RTLSDRCommandStats DeviceExecutor::getStats(int type) {
+    return makeStats(hist[type], coalesced[type], dropped[type]);
+}
+
+RTLSDRCommandStats DeviceExecutor::getTotalStats() {
+    uint64_t c = 0, d = 0;
+    for (int i = 0; i < DEV_CMD_COUNT; i++) {
+        c += coalesced[i];
+        d += dropped[i];
+    }
+    return makeStats(totalHist, c, d);
+}
+
+void DeviceExecutor::clearStats() {
+    for (int i = 0; i < DEV_CMD_COUNT; i++) {
+        hist[i].clear();
+        coalesced[i] = 0;
+        dropped[i] = 0;
+    }
+    totalHist.clear();
+}
+
+RTLSDRCommandStats DeviceExecutor::makeStats(LatencyHistogram& h, uint64_t coalesced, uint64_t dropped) {
+    RTLSDRCommandStats st;
+    st.count = h.getCount();
+    st.p50 = h.percentile(0.5);
+    st.p99 = h.percentile(0.99);
+    st.max = h.getMax();
+    st.coalesced = coalesced;
+    st.dropped = dropped;
+    return st;
+}
+
+void DeviceExecutor::worker() {
+    std::unique_lock<std::mutex> lck(mtx);
+    bool executed = false;
+    while (true) {
+        if (queue.empty()) {
+            if (executed && idle && dev) {
+                Command fn = idle;
+                lck.unlock();
+                fn(dev);
+                lck.lock();
+                executed = false;
+                continue;
+            }
+            if (!running) { break; }
+            cnd.wait(lck);
+            continue;
+        }
+
+        Entry e = queue.front();
+        queue.pop_front();
+        lck.unlock();
+        execute(e);
+        lck.lock();
+        executed = true;
+        if (e.done) {
+            *e.done = true;
+            doneCnd.notify_all();
+        }
+    }
+}
+
+void DeviceExecutor::execute(Entry& e) {
+    if (!dev && e.type != DEV_CMD_OPEN && e.type != DEV_CMD_CLOSE) {
+        dropped[e.type]++;
+        return;
+    }
+
+    auto start = std::chrono::steady_clock::now();
+    e.cmd(dev);
+    auto end = std::chrono::steady_clock::now();
+    if (e.ok) { *e.ok = true; }
+
+    double total = std::chrono::duration<double, std::micro>(end - e.posted).count();
+    hist[e.type].add(total);
+    totalHist.add(total);
+
+    double exec = std::chrono::duration<double, std::milli>(end - start).count();
+    if (exec > DEV_CMD_SLOW_MS) {
+        flog::warn("RTL-SDR '{0}' command took {1}ms", deviceCommandNames[e.type], exec);
+    }
+}
@@ -0,0 +1,102 @@
+#pragma once
+#include <stdint.h>
+#include <deque>
+#include <thread>
+#include <mutex>
+#include <atomic>
+#include <functional>
+#include <condition_variable>
+#include "rtl_device.h"
+#include "latency_histogram.h"
+#include "rtlsdr_interface.h"
+
+// Commands taking longer than this to execute get logged
+#define DEV_CMD_SLOW_MS     100.0
+
+enum DeviceCommandType {
+    DEV_CMD_OPEN,
+    DEV_CMD_CLOSE,
+    DEV_CMD_INIT,
+    DEV_CMD_TUNE,
+    DEV_CMD_PPM,
+    DEV_CMD_DIRECT_SAMPLING,
+    DEV_CMD_IF_FREQ,
+    DEV_CMD_SIDEBAND,
+    DEV_CMD_GAIN_MODE,
+    DEV_CMD_GAIN,
+    DEV_CMD_VGA_GAIN,
+    DEV_CMD_TUNER_REG,
+    DEV_CMD_BIAS_T,
+    DEV_CMD_OFFSET_TUNING,
+    DEV_CMD_RTL_AGC,
+    DEV_CMD_SOFT_AGC,
+    DEV_CMD_FLUSH,
+    DEV_CMD_TELEMETRY,
+    DEV_CMD_COUNT
+};
+
+extern const char* deviceCommandNames[DEV_CMD_COUNT];
+
+// Single thread that owns the device and runs every control call on it in order, telemetry reads
+// included, so the UI never waits on a USB control transfer and nothing races with opening or closing
+// the dongle. Only the bulk reads and their cancel happen elsewhere, they don't go through the control
+// endpoint. Posting a command of the same type and key as one still queued replaces it, only the
+// latest slider value is sent.
+class DeviceExecutor {
+public:
+    typedef std::function<void(RTLDevice* dev)> Command;
+
+    ~DeviceExecutor();
+
+    void start();
+    void stop();
+
+    // Runs on the executor thread, the device then belongs to the executor until close()
+    RTLDevice* open(const std::function<RTLDevice*()>& opener);
+
+    // Drops whatever is still queued and deletes the device
+    void close();
+
+    // Queues and returns right away, the command is dropped if no device is open by the time it runs
+    void post(int type, const Command& cmd, int key = 0);
+
+    // Queues behind everything already posted and waits for it, false if no device was open
+    bool call(int type, const Command& cmd);
+
+    // Runs after the queue drained if at least one command was executed
+    void setIdle(const Command& cmd);
+
+    RTLSDRCommandStats getStats(int type);
+    RTLSDRCommandStats getTotalStats();
+    void clearStats();
+
+private:
+    struct Entry {
+        int type;
+        int key;
+        Command cmd;
+        std::chrono::steady_clock::time_point posted;
+        bool* done;
+        bool* ok;
+    };
+
+    void worker();
+    void execute(Entry& e);
+    RTLSDRCommandStats makeStats(LatencyHistogram& hist, uint64_t coalesced, uint64_t dropped);
+
+    RTLDevice* dev = NULL;
+    Command idle;
+
+    std::thread workerThread;
+    std::mutex mtx;
+    std::condition_variable cnd;
+    std::condition_variable doneCnd;
+    std::deque<Entry> queue;
+    bool running = false;
+
+    // Post to completion
+    LatencyHistogram hist[DEV_CMD_COUNT];
+    LatencyHistogram totalHist;
+    std::atomic<uint64_t> coalesced[DEV_CMD_COUNT] = {};
+    std::atomic<uint64_t> dropped[DEV_CMD_COUNT] = {};
+};
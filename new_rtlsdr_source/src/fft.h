@@ -0,0 +1,57 @@
+#pragma once
+#include <math.h>
+#include <vector>
+#include <utility>
+
+#define FFT_PI  3.14159265358979323846
+
+// Small radix-2 FFT on interleaved complex floats, for the survey and the ppm calibration
+namespace fft {
+    // n/2 complex factors, n a power of two
+    inline void twiddles(std::vector<float>& tw, int n) {
+        tw.resize(n);
+        for (int i = 0; i < n / 2; i++) {
+            tw[2 * i] = (float)cos(-2.0 * FFT_PI * i / (double)n);
+            tw[2 * i + 1] = (float)sin(-2.0 * FFT_PI * i / (double)n);
+        }
+    }
+
+    inline void hann(std::vector<float>& win, int n) {
+        win.resize(n);
+        for (int i = 0; i < n; i++) {
+            win[i] = 0.5f - 0.5f * (float)cos(2.0 * FFT_PI * i / (double)n);
+        }
+    }
+
+    // In place, bin 0 is DC
+    inline void transform(float* data, int n, const float* tw) {
+        for (int i = 1, j = 0; i < n; i++) {
+            int bit = n >> 1;
+            for (; j & bit; bit >>= 1) { j ^= bit; }
+            j ^= bit;
+            if (i < j) {
+                std::swap(data[2 * i], data[2 * j]);
+                std::swap(data[2 * i + 1], data[2 * j + 1]);
+            }
+        }
+
+        for (int len = 2; len <= n; len <<= 1) {
+            int half = len / 2;
+            int tstep = n / len;
+            for (int i = 0; i < n; i += len) {
+                for (int k = 0; k < half; k++) {
+                    float wr = tw[2 * k * tstep];
+                    float wi = tw[2 * k * tstep + 1];
+                    float* a = &data[2 * (i + k)];
+                    float* b = &data[2 * (i + k + half)];
+                    float tr = b[0] * wr - b[1] * wi;
+                    float ti = b[0] * wi + b[1] * wr;
+                    b[0] = a[0] - tr;
+                    b[1] = a[1] - ti;
+                    a[0] += tr;
+                    a[1] += ti;
+                }
+            }
+        }
+    }
+}
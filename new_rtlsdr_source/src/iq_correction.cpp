@@ -0,0 +1,107 @@
+#include "iq_correction.h"
+#include <math.h>
+
+// Same mapping as the plain conversion written as a multiply-add, the corrected output
+// doesn't need to be bit exact with the reference
+#define IQC_SCALE   (1.0f / 128.0f)
+#define IQC_OFFSET  (127.4f / 128.0f)
+#define IQC_PI      3.14159265358979323846
+
+void IQCorrector::init(double sampleRate, double dcTau, double iqTau) {
+    this->sampleRate = sampleRate;
+    this->dcTau = dcTau;
+    this->iqTau = iqTau;
+}
+
+void IQCorrector::reset() {
+    dcI = 0.0;
+    dcQ = 0.0;
+    ii = 1.0;
+    qq = 1.0;
+    iq = 0.0;
+    iqP = 0.0;
+    iqA = 1.0;
+}
+
+void IQCorrector::process(const uint8_t* in, float* out, int count, bool dcCorrection, bool iqCorrection) {
+    if (count <= 0) { return; }
+
+    float offI = IQC_OFFSET + (dcCorrection ? (float)dcI : 0.0f);
+    float offQ = IQC_OFFSET + (dcCorrection ? (float)dcQ : 0.0f);
+    float p = iqCorrection ? (float)iqP : 0.0f;
+    float a = iqCorrection ? (float)iqA : 1.0f;
+
+    // Four independent accumulator lanes so the sums don't serialize the loop
+    float si[4] = { 0 }, sq[4] = { 0 }, sii[4] = { 0 }, sqq[4] = { 0 }, siq[4] = { 0 };
+    int k = 0;
+    for (; k + 4 <= count; k += 4) {
+        for (int l = 0; l < 4; l++) {
+            float i = (float)in[2 * (k + l)] * IQC_SCALE - offI;
+            float q = (float)in[2 * (k + l) + 1] * IQC_SCALE - offQ;
+            si[l] += i;
+            sq[l] += q;
+            sii[l] += i * i;
+            sqq[l] += q * q;
+            siq[l] += i * q;
+            out[2 * (k + l)] = i;
+            out[2 * (k + l) + 1] = a * (q - p * i);
+        }
+    }
+    for (; k < count; k++) {
+        float i = (float)in[2 * k] * IQC_SCALE - offI;
+        float q = (float)in[2 * k + 1] * IQC_SCALE - offQ;
+        si[0] += i;
+        sq[0] += q;
+        sii[0] += i * i;
+        sqq[0] += q * q;
+        siq[0] += i * q;
+        out[2 * k] = i;
+        out[2 * k + 1] = a * (q - p * i);
+    }
+
+    // Fold the block into the estimates, alpha makes the time constants independent of block size
+    double n = count;
+    double blockTime = n / sampleRate;
+    double dcAlpha = 1.0 - exp(-blockTime / dcTau);
+    double iqAlpha = 1.0 - exp(-blockTime / iqTau);
+
+    double tsi = (double)si[0] + si[1] + si[2] + si[3];
+    double tsq = (double)sq[0] + sq[1] + sq[2] + sq[3];
+    double tsii = (double)sii[0] + sii[1] + sii[2] + sii[3];
+    double tsqq = (double)sqq[0] + sqq[1] + sqq[2] + sqq[3];
+    double tsiq = (double)siq[0] + siq[1] + siq[2] + siq[3];
+
+    double mi = tsi / n;
+    double mq = tsq / n;
+    double meanI = mi + (offI - IQC_OFFSET);
+    double meanQ = mq + (offQ - IQC_OFFSET);
+    dcI += dcAlpha * (meanI - dcI);
+    dcQ += dcAlpha * (meanQ - dcQ);
+
+    ii += iqAlpha * ((tsii / n - mi * mi) - ii);
+    qq += iqAlpha * ((tsqq / n - mq * mq) - qq);
+    iq += iqAlpha * ((tsiq / n - mi * mq) - iq);
+
+    // Make Q orthogonal to I and give it the same power (blind Gram-Schmidt correction)
+    if (ii > 1e-12) {
+        double pNew = iq / ii;
+        double rem = qq - iq * pNew;
+        if (rem > 1e-12) {
+            iqP = pNew;
+            iqA = sqrt(ii / rem);
+        }
+    }
+}
+
+float IQCorrector::getGainError() {
+    if (ii <= 1e-12 || qq <= 1e-12) { return 0.0f; }
+    return 10.0f * log10f((float)(qq / ii));
+}
+
+float IQCorrector::getPhaseError() {
+    if (ii <= 1e-12 || qq <= 1e-12) { return 0.0f; }
+    double c = iq / sqrt(ii * qq);
+    if (c > 1.0) { c = 1.0; }
+    if (c < -1.0) { c = -1.0; }
+    return (float)(asin(c) * 180.0 / IQC_PI);
+}
@@ -0,0 +1,40 @@
+#pragma once
+#include <stdint.h>
+
+// Conversion with adaptive DC offset and IQ imbalance correction done in the same pass.
+// The coefficients used on a block come from the estimates of the previous blocks, the block's own
+// statistics are gathered while converting and folded into the estimates afterwards.
+class IQCorrector {
+public:
+    // tau: time constants of the DC and IQ estimates in seconds
+    void init(double sampleRate, double dcTau, double iqTau);
+    void reset();
+
+    // in: raw CU8, out: interleaved floats, count: number of samples
+    void process(const uint8_t* in, float* out, int count, bool dcCorrection, bool iqCorrection);
+
+    float getDcI() { return dcI; }
+    float getDcQ() { return dcQ; }
+
+    // Q to I amplitude ratio in dB and phase error in degrees
+    float getGainError();
+    float getPhaseError();
+
+private:
+    double sampleRate = 1.0;
+    double dcTau = 0.05;
+    double iqTau = 0.5;
+
+    // Residual DC in the float domain (on top of the fixed 127.4 offset)
+    double dcI = 0.0;
+    double dcQ = 0.0;
+
+    // Second moments of the DC free signal
+    double ii = 1.0;
+    double qq = 1.0;
+    double iq = 0.0;
+
+    // Q' = iqA * (Q - iqP * I)
+    double iqP = 0.0;
+    double iqA = 1.0;
+};
@@ -0,0 +1,60 @@
+#pragma once
+#include <stdint.h>
+#include <math.h>
+#include <algorithm>
+#include <atomic>
+
+// 4 buckets per octave from 1us to ~16s, percentiles are accurate to about 19%
+#define LATENCY_HIST_SUB_BUCKETS    4
+#define LATENCY_HIST_OCTAVES        24
+#define LATENCY_HIST_BUCKETS        (LATENCY_HIST_SUB_BUCKETS * LATENCY_HIST_OCTAVES)
+
+// Lock free log scale histogram of durations in microseconds. add() can be called from one thread
+// while others read percentiles.
+class LatencyHistogram {
+public:
+    void add(double us) {
+        int b = 0;
+        if (us > 1.0) {
+            b = (int)(log2(us) * LATENCY_HIST_SUB_BUCKETS);
+            if (b >= LATENCY_HIST_BUCKETS) { b = LATENCY_HIST_BUCKETS - 1; }
+        }
+        buckets[b].fetch_add(1, std::memory_order_relaxed);
+        count.fetch_add(1, std::memory_order_relaxed);
+        if (us > max.load(std::memory_order_relaxed)) { max.store(us, std::memory_order_relaxed); }
+    }
+
+    void clear() {
+        for (auto& b : buckets) { b.store(0, std::memory_order_relaxed); }
+        count = 0;
+        max = 0.0;
+    }
+
+    // p in [0, 1], returns the upper edge of the bucket holding that percentile, 0 if empty
+    double percentile(double p) {
+        uint64_t total = 0;
+        uint64_t snap[LATENCY_HIST_BUCKETS];
+        for (int i = 0; i < LATENCY_HIST_BUCKETS; i++) {
+            snap[i] = buckets[i].load(std::memory_order_relaxed);
+            total += snap[i];
+        }
+        if (!total) { return 0.0; }
+
+        uint64_t target = (uint64_t)ceil(p * (double)total);
+        if (target < 1) { target = 1; }
+        uint64_t acc = 0;
+        for (int i = 0; i < LATENCY_HIST_BUCKETS; i++) {
+            acc += snap[i];
+            if (acc >= target) { return std::min<double>(pow(2.0, (double)(i + 1) / LATENCY_HIST_SUB_BUCKETS), max); }
+        }
+        return max;
+    }
+
+    uint64_t getCount() { return count; }
+    double getMax() { return max; }
+
+private:
+    std::atomic<uint64_t> buckets[LATENCY_HIST_BUCKETS] = {};
+    std::atomic<uint64_t> count = 0;
+    std::atomic<double> max = 0.0;
+};
@@ -7,6 +7,37 @@
 #include <config.h>
 #include <gui/smgui.h>
 #include <rtl-sdr.h>
+#include "conversion.h"
+#include "iq_correction.h"
+#include "decimator.h"
+#include "sample_rates.h"
+#include "buffer_profiles.h"
+#include "spsc_ring.h"
+#include "stream_stats.h"
+#include "rtlsdr_interface.h"
+#include "raw_recorder.h"
+#include "rtl_device.h"
+#include "replay_device.h"
+#include "thread_affinity.h"
+#include "telemetry.h"
+#include "latency_histogram.h"
+#include "sweep.h"
+#include "retune_tracker.h"
+#include "device_executor.h"
+#include "device_cache.h"
+#include "usb_watcher.h"
+#include "soft_agc.h"
+#include "adc_stats.h"
+#include "clock_model.h"
+#include "ppm_calibration.h"
+#include "raw_tap.h"
+#include "buffer_pool.h"
+#include <filesystem>
+#include <fstream>
+#include <map>
+#include <mutex>
+#include <set>
+#include <cfloat>
 
 
 #ifdef __ANDROID__
@@ -20,38 +51,16 @@ SDRPP_MOD_INFO{
     /* Description:     */ "NEW-RTL-SDR source module for SDR++",
     /* Author:          */ "sultan_papagani",
     /* Version:         */ 0, 0, 1,
-    /* Max instances    */ 1
+    /* Max instances    */ -1
 };
 
 ConfigManager config;
 
-const double sampleRates[] = {
-    250000,
-    1024000,
-    1536000,
-    1792000,
-    1920000,
-    2048000,
-    2160000,
-    2400000,
-    2560000,
-    2880000,
-    3200000
-};
-
-const char* sampleRatesTxt[] = {
-    "250KHz",
-    "1.024MHz",
-    "1.536MHz",
-    "1.792MHz",
-    "1.92MHz",
-    "2.048MHz",
-    "2.16MHz",
-    "2.4MHz",
-    "2.56MHz",
-    "2.88MHz",
-    "3.2MHz"
-};
+// Shared by all instances so they don't register the same source name or default to the same dongle
+std::mutex instancesMtx;
+DeviceCache deviceCache;
+std::set<std::string> usedSourceNames;
+std::map<std::string, std::string> claimedDevices;
 
 //const char* channelFilQTxt = "High Q\0Low Q";
 
@@ -69,7 +78,7 @@ const char* sampleRatesTxt[] = {
 
 //const char* trackingFilterTxt = "On\0Bypass\0";
 
-const char* agcModesTxt = "Hardware\0Software\0";
+const char* agcModesTxt = "Hardware\0Software\0Module\0";
 
 const char* sidebandTxt = "Lower Side\0Upper Side\0";
 
@@ -77,8 +86,49 @@ const char* directSamplingModesTxt = "Disabled\0I branch\0Q branch\0";
 
 const char* agcClockTxt = "300ms\0 80ms\0 20ms\0";
 
+// Time constants of the adaptive DC and IQ imbalance estimates
+#define IQ_CORRECTION_DC_TAU    0.05
+#define IQ_CORRECTION_IQ_TAU    0.5
+
+// Times a retune is retried when the tuner refuses it or its PLL doesn't lock
+#define RETUNE_MAX_ATTEMPTS     10
+
+// R82xx tuners report the PLL lock in bit 6 of register 2
+#define R82XX_LOCK_REG          2
+#define R82XX_LOCK_BIT          0x40
+
+// Settle time measurement hops between the current frequency and one this far above
+#define SETTLE_MEASURE_COUNT    8
+#define SETTLE_MEASURE_STEP     1000000.0
+#define SETTLE_MEASURE_TIMEOUT  1.0
+
+// Real time priority of the USB thread when FIFO or RR is picked, the converter gets one less
+#define SCHED_DEFAULT_PRIORITY  10
+
+const char* replayPacingTxt = "Real Time\0Max Speed\0";
+
+const char* bufferProfilesTxt = "Low Latency\0Balanced\0Max Throughput\0Custom\0";
+const char* schedPoliciesTxt = "Normal\0FIFO\0Round Robin\0";
+const char* sweepFftSizesTxt = "256\0" "512\0" "1024\0" "2048\0" "4096\0";
+const char* sweepFormatsTxt = "CSV\0Binary\0";
+const char* settleModesTxt = "Off\0Blank\0Drop\0";
+const char* decimationTxt = "None\0" "2\0" "4\0" "8\0" "16\0" "32\0" "64\0";
+
 //const char* rfFilterRejectTxt = "Highest Band\0 Med Band\0 Low Band\0";
 
+// Everything start() programs into the device, kept to only rewrite what changed after a warm standby
+struct DeviceSetup {
+    uint32_t sampleRate;
+    uint32_t freq;
+    int ppm;
+    int directSampling;
+    bool biasT;
+    bool rtlAgc;
+    int gainMode;
+    int gain;
+    bool offsetTuning;
+};
+
 class RTLSDRSourceModule : public ModuleManager::Instance {
 public:
     RTLSDRSourceModule(std::string name) {
@@ -88,6 +138,10 @@ public:
 
         sampleRate = sampleRates[0];
 
+        convKernel = cu8::best();
+        convert = cu8::get(convKernel);
+        flog::info("RTLSDRSourceModule '{0}': Using {1} sample conversion", name, cu8::kernelNames[convKernel]);
+
         handler.ctx = this;
         handler.selectHandler = menuSelected;
         handler.deselectHandler = menuDeselected;
@@ -101,6 +155,7 @@ public:
         strcpy(lnaGainTxt, "0");
         strcpy(vgaGainTxt, "0");
         strcpy(mixerGainTxt, "0");
+        strcpy(bufferInfoTxt, "");
 
         //strcpy(lnaAgcPdetHigh, "0.34V");
         //strcpy(lnaAgcPdetLow, "0.34V");
@@ -113,25 +168,124 @@ public:
             sampleRateListTxt += '\0';
         }
 
-        refresh();
+        // The first instance keeps the old source name so existing setups still find it
+        {
+            std::lock_guard<std::mutex> lck(instancesMtx);
+            sourceName = "NEW-RTL-SDR";
+            if (usedSourceNames.count(sourceName)) { sourceName += " (" + name + ")"; }
+            usedSourceNames.insert(sourceName);
+        }
 
         config.acquire();
-        if (!config.conf["device"].is_string()) {
+        if (!config.conf.contains("instances")) {
+            config.conf["instances"] = json({});
+        }
+        if (config.conf["instances"].contains(name) && config.conf["instances"][name]["device"].is_string()) {
+            selectedDevName = config.conf["instances"][name]["device"];
+        }
+        else if (config.conf["device"].is_string()) {
+            // Config from before instances had their own section
+            selectedDevName = config.conf["device"];
+            config.conf["instances"][name]["device"] = selectedDevName;
+        }
+        else {
             selectedDevName = "";
-            config.conf["device"] = "";
+            config.conf["instances"][name]["device"] = "";
+        }
+        if (config.conf["instances"][name].contains("cpuAffinity") && config.conf["instances"][name]["cpuAffinity"].is_string()) {
+            // Older configs had one CPU list for the instance, it's the default for devices without their own
+            legacyCpus = config.conf["instances"][name]["cpuAffinity"];
+        }
+        if (config.conf["instances"][name].contains("settleMode")) {
+            settleMode = std::clamp<int>(config.conf["instances"][name]["settleMode"], 0, SETTLE_MODE_DROP);
+        }
+        if (config.conf["instances"][name].contains("fastTune")) {
+            fastTune = config.conf["instances"][name]["fastTune"];
+        }
+        if (config.conf["instances"][name].contains("adcStats")) {
+            adcStatsOn = config.conf["instances"][name]["adcStats"];
+        }
+        if (config.conf["instances"][name].contains("hugePages")) {
+            hugePages = config.conf["instances"][name]["hugePages"];
+        }
+        if (config.conf["instances"][name].contains("lockBuffers")) {
+            lockBuffers = config.conf["instances"][name]["lockBuffers"];
+        }
+        if (config.conf["instances"][name].contains("warmStandby")) {
+            warmStandby = config.conf["instances"][name]["warmStandby"];
+        }
+        if (config.conf["instances"][name].contains("sweep")) {
+            json sw = config.conf["instances"][name]["sweep"];
+            if (sw.contains("ranges") && sw["ranges"].is_string()) {
+                std::string ranges = sw["ranges"];
+                strncpy(sweepRangesTxt, ranges.c_str(), sizeof(sweepRangesTxt) - 1);
+                sweepRangesTxt[sizeof(sweepRangesTxt) - 1] = 0;
+            }
+            if (sw.contains("fftSize")) { sweepFftSizeId = std::clamp<int>(sw["fftSize"], 0, 4); }
+            if (sw.contains("dwell")) { sweepDwell = std::clamp<int>(sw["dwell"], 1, 60000); }
+            if (sw.contains("settle")) { sweepSettle = std::clamp<int>(sw["settle"], 0, 10000); }
+            if (sw.contains("format")) { sweepFormat = std::clamp<int>(sw["format"], 0, 1); }
+            if (sw.contains("loop")) { sweepLoop = sw["loop"]; }
+        }
+        if (config.conf["instances"][name].contains("ppmCal")) {
+            json pc = config.conf["instances"][name]["ppmCal"];
+            if (pc.contains("refFreq")) { ppmCalRef = std::clamp<double>(pc["refFreq"], 0.0, 2e9); }
+            if (pc.contains("dwell")) { ppmCalDwell = std::clamp<int>(pc["dwell"], 10, 10000); }
+            if (pc.contains("interval")) { ppmCalInterval = std::clamp<int>(pc["interval"], 0, 1440); }
+        }
+        if (config.conf["instances"][name].contains("softAgc")) {
+            json sa = config.conf["instances"][name]["softAgc"];
+            if (sa.contains("target")) { softAgcTarget = std::clamp<float>(sa["target"], -40.0f, -1.0f); }
+            if (sa.contains("attack")) { softAgcAttack = std::clamp<float>(sa["attack"], 0.1f, 1000.0f); }
+            if (sa.contains("decay")) { softAgcDecay = std::clamp<float>(sa["decay"], 1.0f, 10000.0f); }
+            if (sa.contains("hysteresis")) { softAgcHysteresis = std::clamp<float>(sa["hysteresis"], 0.5f, 10.0f); }
+        }
+        softAgc.setTarget(softAgcTarget);
+        softAgc.setAttack(softAgcAttack);
+        softAgc.setDecay(softAgcDecay);
+        softAgc.setHysteresis(softAgcHysteresis);
+        if (config.conf["instances"][name].contains("telemetryRate")) {
+            telemetryRate = std::clamp<int>(config.conf["instances"][name]["telemetryRate"], 0, TELEMETRY_MAX_RATE);
+        }
+        if (config.conf.contains("rawRecordPath") && config.conf["rawRecordPath"].is_string()) {
+            std::string path = config.conf["rawRecordPath"];
+            strncpy(rawRecPath, path.c_str(), sizeof(rawRecPath) - 1);
+            rawRecPath[sizeof(rawRecPath) - 1] = 0;
         }
         else {
-            selectedDevName = config.conf["device"];
+            std::string path = (std::string)core::args["root"].s() + "/recordings";
+            strncpy(rawRecPath, path.c_str(), sizeof(rawRecPath) - 1);
+            rawRecPath[sizeof(rawRecPath) - 1] = 0;
+        }
+        if (!deviceCache.isLoaded()) {
+            deviceCache.load(config.conf.contains("deviceCache") ? config.conf["deviceCache"] : json({}));
         }
         config.release(true);
+
+        // Tuner register writes queued by a burst of commands go out together once it's done
+        executor.setIdle([](RTLDevice* dev) { dev->flushTunerRegs(); });
+        executor.start();
+
+        refresh();
         selectByName(selectedDevName);
+        if (!usbWatcher.start(devicesChanged, this)) {
+            flog::info("RTLSDRSourceModule '{0}': No USB hotplug support, the device list only updates on refresh", name);
+        }
 
-        sigpath::sourceManager.registerSource("NEW-RTL-SDR", &handler);
+        sigpath::sourceManager.registerSource(sourceName, &handler);
+        core::modComManager.registerInterface("new_rtlsdr_source", name, moduleInterfaceHandler, this);
     }
 
     ~RTLSDRSourceModule() {
+        usbWatcher.stop();
         stop(this);
-        sigpath::sourceManager.unregisterSource("NEW-RTL-SDR");
+        executor.stop();
+        sigpath::sourceManager.unregisterSource(sourceName);
+        core::modComManager.unregisterInterface(name);
+
+        std::lock_guard<std::mutex> lck(instancesMtx);
+        usedSourceNames.erase(sourceName);
+        claimedDevices.erase(name);
     }
 
     void postInit() {}
@@ -150,20 +304,48 @@ public:
 
     void refresh() {
         devNames.clear();
+        devCapsKeys.clear();
+        devLocations.clear();
+        devSerials.clear();
         devListTxt = "";
 
 #ifndef __ANDROID__
         devCount = rtlsdr_get_device_count();
+
+        // USB strings can only be read by opening the dongle, they're cached by port when libusb can tell it
+        std::vector<UsbDongle> dongles;
+        bool located = usbWatcher.enumerate(dongles) && (int)dongles.size() == devCount;
         char buf[1024];
-        char snBuf[1024];
+        char manBuf[256];
+        char prodBuf[256];
+        char snBuf[256];
         for (int i = 0; i < devCount; i++) {
             // Gather device info
             const char* devName = rtlsdr_get_device_name(i);
-            int snErr = rtlsdr_get_device_usb_strings(i, NULL, NULL, snBuf);
+            DeviceStrings strs;
+            if (!located || !deviceCache.getStrings(dongles[i].location, dongles[i].vid, dongles[i].pid, strs)) {
+                if (!rtlsdr_get_device_usb_strings(i, manBuf, prodBuf, snBuf)) {
+                    if (located) {
+                        strs.vid = dongles[i].vid;
+                        strs.pid = dongles[i].pid;
+                    }
+                    strs.manufacturer = manBuf;
+                    strs.product = prodBuf;
+                    strs.serial = snBuf;
+                    if (located) { deviceCache.putStrings(dongles[i].location, strs); }
+                }
+            }
 
             // Build name
-            sprintf(buf, "[%s] %s##%d", (!snErr && snBuf[0]) ? snBuf : "No Serial", devName, i);
+            sprintf(buf, "[%s] %s##%d", !strs.serial.empty() ? strs.serial.c_str() : "No Serial", devName, i);
             devNames.push_back(buf);
+            devLocations.push_back(located ? dongles[i].location : "");
+            devSerials.push_back(strs.serial);
+
+            // Dongles without a serial can't be told apart by model, they're told apart by port
+            std::string capsKey = std::string(devName) + "/" + strs.serial;
+            if (strs.serial.empty()) { capsKey += located ? ("@" + dongles[i].location) : ("#" + std::to_string(i)); }
+            devCapsKeys.push_back(capsKey);
             devListTxt += buf;
             devListTxt += '\0';
         }
@@ -172,23 +354,80 @@ public:
         devCount = 0;
         int vid, pid;
         devFd = backend::getDeviceFD(vid, pid, backend::RTL_SDR_VIDPIDS);
-        if (devFd < 0) { return; }
-
-        // Generate fake device info
-        devCount = 1;
-        std::string fakeName = "RTL-SDR Dongle USB";
-        devNames.push_back(fakeName);
-        devListTxt += fakeName;
-        devListTxt += '\0';
+        if (devFd >= 0) {
+            // Generate fake device info
+            devCount = 1;
+            std::string fakeName = "RTL-SDR Dongle USB";
+            devNames.push_back(fakeName);
+            devCapsKeys.push_back(fakeName);
+            devLocations.push_back("");
+            devSerials.push_back("");
+            devListTxt += fakeName;
+            devListTxt += '\0';
+        }
 #endif
+
+        // CU8 files in the recordings folder can be played back like a dongle
+        realDevCount = devCount;
+        replayFiles.clear();
+        std::error_code ec;
+        for (const auto& entry : std::filesystem::directory_iterator(rawRecPath, ec)) {
+            std::string ext = entry.path().extension().string();
+            if (ext != ".sigmf-data" && ext != ".cu8") { continue; }
+            std::string replayName = "[Replay] " + entry.path().filename().string();
+            replayFiles.push_back(entry.path().string());
+            devNames.push_back(replayName);
+            devCapsKeys.push_back(replayName);
+            devLocations.push_back("");
+            devSerials.push_back("");
+            devListTxt += replayName;
+            devListTxt += '\0';
+            devCount++;
+        }
     }
 
+    // Opens a dongle or replay file by its index in the device list
+    RTLDevice* openDevice(int id) {
+        if (id >= realDevCount) {
+            ReplayDevice* replayDev = new ReplayDevice(replayFiles[id - realDevCount], replayPacing, replayLoop);
+            if (!replayDev->isOpen()) {
+                delete replayDev;
+                return NULL;
+            }
+            return replayDev;
+        }
+
+        int err;
+#ifndef __ANDROID__
+        RTLDevice* d = LibRTLDevice::open(id, err);
+#else
+        RTLDevice* d = LibRTLDevice::openSys(devFd, err);
+#endif
+        if (!d) { flog::error("Could not open RTL-SDR: {0}", err); }
+        return d;
+    }
+
+    // Prefers a device no other instance has selected
     void selectFirst() {
+        for (int i = 0; i < realDevCount; i++) {
+            if (!claimedByOther(devNames[i])) {
+                selectById(i);
+                return;
+            }
+        }
         if (devCount > 0) {
             selectById(0);
         }
     }
 
+    bool claimedByOther(const std::string& devName) {
+        std::lock_guard<std::mutex> lck(instancesMtx);
+        for (const auto& [inst, dev] : claimedDevices) {
+            if (inst != name && dev == devName) { return true; }
+        }
+        return false;
+    }
+
     void selectByName(std::string name) {
         for (int i = 0; i < devCount; i++) {
             if (name == devNames[i]) {
@@ -200,26 +439,38 @@ public:
     }
 
     void selectById(int id) {
+        closeStandby();
         selectedDevName = devNames[id];
-
-#ifndef __ANDROID__
-        int oret = rtlsdr_open(&openDev, id);
-#else
-        int oret = rtlsdr_open_sys_dev(&openDev, devFd);
-#endif
-        
-        if (oret < 0) {
-            selectedDevName = "";
-            flog::error("Could not open RTL-SDR: {0}", oret);
-            return;
+        devId = id;
+        isReplay = (id >= realDevCount);
+        {
+            std::lock_guard<std::mutex> lck(instancesMtx);
+            claimedDevices[name] = selectedDevName;
         }
 
-        gainList.clear();
-        int gains[256];
-        int n = rtlsdr_get_tuner_gains(openDev, gains);
+        // Only opened if the cache doesn't know it yet, on the executor like every other device access
+        DeviceCaps caps;
+        if (isReplay || !deviceCache.getCaps(devCapsKeys[id], caps)) {
+            bool opened = false;
+            executor.call(DEV_CMD_OPEN, [this, id, &opened, &caps](RTLDevice* dev) {
+                RTLDevice* pdev = openDevice(id);
+                if (!pdev) { return; }
+                readCaps(pdev, caps);
+                delete pdev;
+                opened = true;
+            });
+            if (!opened) {
+                selectedDevName = "";
+                return;
+            }
+            if (!isReplay) {
+                deviceCache.putCaps(devCapsKeys[id], caps);
+                saveDeviceCache();
+            }
+        }
 
-        gainList = std::vector<int>(gains, gains + n);
-        std::sort(gainList.begin(), gainList.end());
+        gainList = caps.gains;
+        capsTuner = caps.tuner;
 
         // I HATE DEHYDRATED PISS YELLOW COLOR
         ImGuiStyle* style = &ImGui::GetStyle();
@@ -236,11 +487,17 @@ public:
             config.conf["devices"][selectedDevName]["ppm"] = 0;
             config.conf["devices"][selectedDevName]["biasT"] = biasT;
             config.conf["devices"][selectedDevName]["offsetTuning"] = offsetTuning;
+            config.conf["devices"][selectedDevName]["dcCorrection"] = dcCorrection;
+            config.conf["devices"][selectedDevName]["iqCorrection"] = iqCorrection;
+            config.conf["devices"][selectedDevName]["decimation"] = decimation;
             config.conf["devices"][selectedDevName]["rtlAgc"] = rtlAgc;
             //config.conf["devices"][selectedDevName]["tunerAgc"] = tunerAgc;
             config.conf["devices"][selectedDevName]["gain"] = gainId;
+            config.conf["devices"][selectedDevName]["bufferProfile"] = bufferProfile;
+            config.conf["devices"][selectedDevName]["bufferCount"] = customBufferCount;
+            config.conf["devices"][selectedDevName]["transferSize"] = customTransferSize;
         }
-        if (gainId >= gainList.size()) { gainId = gainList.size() - 1; }
+        clampGainId();
         updateGainTxt();
 
         // Load config
@@ -272,6 +529,23 @@ public:
             offsetTuning = config.conf["devices"][selectedDevName]["offsetTuning"];
         }
 
+        if (config.conf["devices"][selectedDevName].contains("dcCorrection")) {
+            dcCorrection = config.conf["devices"][selectedDevName]["dcCorrection"];
+        }
+
+        if (config.conf["devices"][selectedDevName].contains("iqCorrection")) {
+            iqCorrection = config.conf["devices"][selectedDevName]["iqCorrection"];
+        }
+
+        settleTime = RETUNE_DEFAULT_SETTLE;
+        if (config.conf["devices"][selectedDevName].contains("settleTime")) {
+            settleTime = config.conf["devices"][selectedDevName]["settleTime"];
+        }
+
+        if (config.conf["devices"][selectedDevName].contains("decimation")) {
+            decimation = std::clamp<int>(config.conf["devices"][selectedDevName]["decimation"], 0, DECIM_MAX_STAGES);
+        }
+
         if (config.conf["devices"][selectedDevName].contains("rtlAgc")) {
             rtlAgc = config.conf["devices"][selectedDevName]["rtlAgc"];
         }
@@ -282,12 +556,79 @@ public:
 
         if (config.conf["devices"][selectedDevName].contains("gain")) {
             gainId = config.conf["devices"][selectedDevName]["gain"];
+            clampGainId();
             updateGainTxt();
         }
 
+        if (config.conf["devices"][selectedDevName].contains("bufferProfile")) {
+            bufferProfile = std::clamp<int>(config.conf["devices"][selectedDevName]["bufferProfile"], 0, BUFFER_PROFILE_CUSTOM);
+        }
+
+        if (config.conf["devices"][selectedDevName].contains("bufferCount")) {
+            customBufferCount = config.conf["devices"][selectedDevName]["bufferCount"];
+        }
+
+        if (config.conf["devices"][selectedDevName].contains("transferSize")) {
+            customTransferSize = config.conf["devices"][selectedDevName]["transferSize"];
+        }
+
+        std::string usbCpus = legacyCpus;
+        std::string convCpus = legacyCpus;
+        if (config.conf["devices"][selectedDevName].contains("usbCpus")) {
+            usbCpus = config.conf["devices"][selectedDevName]["usbCpus"];
+        }
+        if (config.conf["devices"][selectedDevName].contains("convCpus")) {
+            convCpus = config.conf["devices"][selectedDevName]["convCpus"];
+        }
+        setCpus(usbCpus, usbCpusTxt, sizeof(usbCpusTxt), this->usbCpus);
+        setCpus(convCpus, convCpusTxt, sizeof(convCpusTxt), this->convCpus);
+
+        schedPolicy = affinity::POLICY_NORMAL;
+        schedPriority = SCHED_DEFAULT_PRIORITY;
+        if (config.conf["devices"][selectedDevName].contains("schedPolicy")) {
+            schedPolicy = std::clamp<int>(config.conf["devices"][selectedDevName]["schedPolicy"], affinity::POLICY_NORMAL, affinity::POLICY_RR);
+        }
+        if (config.conf["devices"][selectedDevName].contains("schedPriority")) {
+            schedPriority = std::clamp<int>(config.conf["devices"][selectedDevName]["schedPriority"], 1, 99);
+        }
+
+        if (config.conf["devices"][selectedDevName].contains("replayPacing")) {
+            replayPacing = config.conf["devices"][selectedDevName]["replayPacing"];
+        }
+
+        if (config.conf["devices"][selectedDevName].contains("replayLoop")) {
+            replayLoop = config.conf["devices"][selectedDevName]["replayLoop"];
+        }
+
         config.release(created);
 
-        rtlsdr_close(openDev);
+        // Recordings made by this module know their sample rate
+        if (isReplay) { loadReplayMeta(replayFiles[id - realDevCount]); }
+        updateBufferParams();
+
+    }
+
+    void loadReplayMeta(const std::string& path) {
+        std::string ext = ".sigmf-data";
+        if (path.size() <= ext.size() || path.compare(path.size() - ext.size(), ext.size(), ext)) { return; }
+
+        std::ifstream file(path.substr(0, path.size() - ext.size()) + ".sigmf-meta");
+        if (!file.is_open()) { return; }
+        try {
+            json meta = json::parse(file);
+            double sr = meta["global"]["core:sample_rate"];
+            for (int i = 0; i < 11; i++) {
+                if (sampleRates[i] == sr) {
+                    srId = i;
+                    sampleRate = sr;
+                    return;
+                }
+            }
+            flog::warn("Replay sample rate {0} is not a supported rate", sr);
+        }
+        catch (const std::exception& e) {
+            flog::error("Could not read replay metadata: {0}", e.what());
+        }
     }
 
 private:
@@ -307,7 +648,7 @@ private:
 
     static void menuSelected(void* ctx) {
         RTLSDRSourceModule* _this = (RTLSDRSourceModule*)ctx;
-        core::setInputSampleRate(_this->sampleRate);
+        core::setInputSampleRate(_this->getOutputRate());
         flog::info("RTLSDRSourceModule '{0}': Menu Select!", _this->name);
     }
 
@@ -324,79 +665,145 @@ private:
             return;
         }
 
-#ifndef __ANDROID__
-        int oret = rtlsdr_open(&_this->openDev, _this->devId);
-#else
-        int oret = rtlsdr_open_sys_dev(&_this->openDev, _this->devFd);
-#endif
-
-        if (oret < 0) {
+        _this->startTime = std::chrono::steady_clock::now();
+        _this->firstSampleTime = -1.0;
+        bool warm = _this->standby;
+        _this->standby = false;
+        if (!warm) {
+            _this->dev = _this->executor.open([_this]() { return _this->openDevice(_this->devId); });
+        }
+        if (!_this->dev) {
             flog::error("Could not open RTL-SDR");
             return;
         }
 
         flog::info("RTL-SDR Sample Rate: {0}", _this->sampleRate);
 
-        rtlsdr_set_sample_rate(_this->openDev, _this->sampleRate);
-        rtlsdr_set_center_freq(_this->openDev, _this->freq);
-        rtlsdr_set_freq_correction(_this->openDev, _this->ppm);
-        rtlsdr_set_tuner_bandwidth(_this->openDev, 0);
-        rtlsdr_set_direct_sampling(_this->openDev, _this->directSamplingMode);
-        rtlsdr_set_bias_tee(_this->openDev, _this->biasT);
-        rtlsdr_set_agc_mode(_this->openDev, _this->rtlAgc);
-        rtlsdr_set_tuner_gain(_this->openDev, _this->gainList[_this->gainId]);
-        
-        rtlsdr_set_tuner_gain_mode(_this->openDev, 1); //manual mode default
-        rtlsdr_set_tuner_gain(_this->openDev, _this->gainList[_this->gainId]);
-
-        rtlsdr_set_offset_tuning(_this->openDev, _this->offsetTuning);
-
-        rtlsdr_tuner tuner_type = rtlsdr_get_tuner_type(_this->openDev);
+        // Dongles sharing a model and serial can still differ, the cache entry follows the last one opened.
+        // The caps are read first and applied here so the setup uses a gain from the right table
+        DeviceCaps caps;
+        _this->executor.call(DEV_CMD_INIT, [_this, &caps](RTLDevice* dev) {
+            readCaps(dev, caps);
+            if (!_this->isReplay) { _this->verifyStrings(dev); }
+        });
+        if (!_this->isReplay && caps.tuner != _this->capsTuner) { _this->updateCaps(caps); }
+
+        DeviceSetup want = _this->getSetup();
+        _this->executor.call(DEV_CMD_INIT, [_this, &want, warm](RTLDevice* dev) {
+            _this->applySetup(dev, want, warm ? &_this->applied : NULL);
+        });
+
+        rtlsdr_tuner tuner_type = (rtlsdr_tuner)caps.tuner;
         if (tuner_type == RTLSDR_TUNER_R820T || tuner_type == RTLSDR_TUNER_R828D)
         {
             if (tuner_type == RTLSDR_TUNER_R828D){_this->showIQ = false;}
         }
         else{_this->correctTuner = false;}
 
-        _this->asyncCount = (int)roundf(_this->sampleRate / (200 * 512)) * 512;
-
+        _this->telemetry.start(&_this->executor, _this->telemetryRate);
+
+        // The setup leaves the tuner in manual mode, which is what the module AGC drives
+        if (_this->softAgcOn) { _this->postControlMode(); }
+
+        _this->updateBufferParams();
+
+        // The ring and the raw tap come out of the pool, it only ever grows so restarts don't allocate
+        size_t ringBytes = (size_t)_this->ringSlots * _this->asyncCount;
+        size_t tapBytes = RawTap::bytes(_this->asyncCount);
+        bool pooled = _this->pool.reserve(ringBytes + tapBytes + 2 * BUFFER_POOL_ALIGN, _this->hugePages, _this->lockBuffers);
+        _this->ring.init(_this->ringSlots, _this->asyncCount, pooled ? _this->pool.take(ringBytes) : NULL);
+        _this->rawTap.init(_this->asyncCount, pooled ? _this->pool.take(tapBytes) : NULL);
+        _this->stats.reset(_this->sampleRate, _this->asyncCount / 2, _this->asyncBufCount);
+        _this->corrector.init(_this->sampleRate, IQ_CORRECTION_DC_TAU, IQ_CORRECTION_IQ_TAU);
+        _this->corrector.reset();
+        _this->decimator.init(_this->decimation, _this->asyncCount / 2);
+        _this->tracker.reset(_this->sampleRate, _this->asyncCount / 2);
+        _this->softAgc.reset(_this->sampleRate, (_this->asyncBufCount + 1) * (_this->asyncCount / 2));
+        _this->adcStats.reset();
+        _this->sampleClock.reset(_this->sampleRate, _this->asyncCount / 2);
+        _this->tracker.setSettle(_this->settleTime);
+        _this->tracker.setMode(_this->settleMode);
+        _this->streamPos = 0;
+        flog::info("RTL-SDR Buffers: {0} x {1} bytes", _this->asyncBufCount, _this->asyncCount);
+
+        // Set before the threads exist, the usb callback and the converter check it
+        _this->running = true;
+        _this->convThread = std::thread(&RTLSDRSourceModule::convWorker, _this);
         _this->workerThread = std::thread(&RTLSDRSourceModule::worker, _this);
+        _this->applyThreadSettings();
 
-        _this->running = true;
-        flog::info("RTLSDRSourceModule '{0}': Start!", _this->name);
+        _this->warmStart = warm;
+        flog::info("RTLSDRSourceModule '{0}': Start! ({1})", _this->name, warm ? "warm" : "cold");
     }
 
     static void stop(void* ctx) {
         RTLSDRSourceModule* _this = (RTLSDRSourceModule*)ctx;
         if (!_this->running) { return; }
         _this->running = false;
+        _this->sweeper.stop();
+        _this->ppmCal.stop();
+        _this->takeCalibratedPpm();
+        if (_this->settleThread.joinable()) { _this->settleThread.join(); }
+        _this->takeSettleTime();
         _this->stream.stopWriter();
-        rtlsdr_cancel_async(_this->openDev);
+        _this->dev->cancelAsync();
         if (_this->workerThread.joinable()) { _this->workerThread.join(); }
+        _this->telemetry.stop();
+        _this->stopRawRecording();
+        _this->ring.stop();
+        if (_this->convThread.joinable()) { _this->convThread.join(); }
         _this->stream.clearWriteStop();
-        rtlsdr_close(_this->openDev);
+
+        if (_this->warmStandby && !_this->isReplay) {
+            // Keep the device open, wait for what's still queued and remember what it ends up set to
+            _this->executor.call(DEV_CMD_FLUSH, [_this](RTLDevice* dev) {
+                dev->flushTunerRegs();
+                _this->applied = _this->getSetup();
+                _this->applied.freq = dev->getCenterFreq();
+            });
+            _this->standby = true;
+            flog::info("RTLSDRSourceModule '{0}': Stop! (standby)", _this->name);
+            return;
+        }
+        _this->executor.close();
+        _this->dev = NULL;
         flog::info("RTLSDRSourceModule '{0}': Stop!", _this->name);
     }
 
     static void tune(double freq, void* ctx) {
         RTLSDRSourceModule* _this = (RTLSDRSourceModule*)ctx;
+        if (_this->tunerBusy()) {
+            // The sweep, the calibration or the settle measurement owns the tuner, go there once it's done
+            _this->freq = freq;
+            _this->releaseFreq = freq;
+            return;
+        }
         if (_this->running) {
-            uint32_t newFreq = freq;
-            int i;
-            for (i = 0; i < 10; i++) {
-                rtlsdr_set_center_freq(_this->openDev, freq);
-                if (rtlsdr_get_center_freq(_this->openDev) == newFreq) { break; }
-            }
-            if (i > 1) {
-                flog::warn("RTL-SDR took {0} attempts to tune...", i);
-            }
+            _this->executor.post(DEV_CMD_TUNE, [_this, freq](RTLDevice* dev) { _this->retune(freq); });
         }
         _this->freq = freq;
+        _this->releaseFreq = freq;
+        if (_this->recorder.isRecording()) { _this->recorder.retune(freq); }
         flog::info("RTLSDRSourceModule '{0}': Tune: {1}!", _this->name, freq);
     }
 
     static void menuHandler(void* ctx) {
         RTLSDRSourceModule* _this = (RTLSDRSourceModule*)ctx;
+        _this->takeCalibratedPpm();
+        _this->takeSettleTime();
+
+        // Dongles were plugged in or removed, the selection stays if its entry didn't change
+        if (_this->devicesPending && !_this->running) {
+            _this->devicesPending = false;
+            std::string prevName = _this->selectedDevName;
+            int prevId = _this->devId;
+            _this->refresh();
+            if (prevId >= _this->devCount || _this->devNames[prevId] != prevName) {
+                _this->selectByName(prevName);
+                core::setInputSampleRate(_this->getOutputRate());
+            }
+            _this->saveDeviceCache();
+        }
 
         if (!_this->correctTuner)
         {
@@ -409,17 +816,18 @@ private:
         SmGui::ForceSync();
         if (SmGui::Combo(CONCAT("##_rtlsdr_dev_sel_", _this->name), &_this->devId, _this->devListTxt.c_str())) {
             _this->selectById(_this->devId);
-            core::setInputSampleRate(_this->sampleRate);
+            core::setInputSampleRate(_this->getOutputRate());
             if (_this->selectedDevName != "") {
                 config.acquire();
-                config.conf["device"] = _this->selectedDevName;
+                config.conf["instances"][_this->name]["device"] = _this->selectedDevName;
                 config.release(true);
             }
         }
 
         if (SmGui::Combo(CONCAT("##_rtlsdr_sr_sel_", _this->name), &_this->srId, _this->sampleRateListTxt.c_str())) {
             _this->sampleRate = sampleRates[_this->srId];
-            core::setInputSampleRate(_this->sampleRate);
+            _this->updateBufferParams();
+            core::setInputSampleRate(_this->getOutputRate());
             if (_this->selectedDevName != "") {
                 config.acquire();
                 config.conf["devices"][_this->selectedDevName]["sampleRate"] = _this->sampleRate;
@@ -433,11 +841,117 @@ private:
         if (SmGui::Button(CONCAT("Refresh##_rtlsdr_refr_", _this->name)/*, ImVec2(refreshBtnWdith, 0)*/)) {
             _this->refresh();
             _this->selectByName(_this->selectedDevName);
-            core::setInputSampleRate(_this->sampleRate);
+            core::setInputSampleRate(_this->getOutputRate());
+            _this->saveDeviceCache();
+        }
+
+        SmGui::LeftLabel("Decimation");
+        SmGui::FillWidth();
+        if (SmGui::Combo(CONCAT("##_rtlsdr_decim_", _this->name), &_this->decimation, decimationTxt)) {
+            core::setInputSampleRate(_this->getOutputRate());
+            if (_this->selectedDevName != "") {
+                config.acquire();
+                config.conf["devices"][_this->selectedDevName]["decimation"] = _this->decimation;
+                config.release(true);
+            }
+        }
+
+        SmGui::LeftLabel("Buffering");
+        SmGui::FillWidth();
+        if (SmGui::Combo(CONCAT("##_rtlsdr_bufprof_", _this->name), &_this->bufferProfile, bufferProfilesTxt)) {
+            _this->updateBufferParams();
+            _this->saveBufferConfig();
+        }
+
+        if (_this->bufferProfile == BUFFER_PROFILE_CUSTOM) {
+            SmGui::LeftLabel("Buffer Count");
+            SmGui::FillWidth();
+            if (SmGui::InputInt(CONCAT("##_rtlsdr_bufcount_", _this->name), &_this->customBufferCount, 1, 4)) {
+                _this->updateBufferParams();
+                _this->saveBufferConfig();
+            }
+
+            SmGui::LeftLabel("Transfer Size");
+            SmGui::FillWidth();
+            if (SmGui::InputInt(CONCAT("##_rtlsdr_transize_", _this->name), &_this->customTransferSize, RTL_TRANSFER_ALIGN, 16 * RTL_TRANSFER_ALIGN)) {
+                _this->updateBufferParams();
+                _this->saveBufferConfig();
+            }
         }
 
+        SmGui::Text(_this->bufferInfoTxt);
+
+        if (_this->running) { SmGui::BeginDisabled(); }
+        if (SmGui::Checkbox(CONCAT("Huge Pages##_rtlsdr_hugepages_", _this->name), &_this->hugePages)) {
+            config.acquire();
+            config.conf["instances"][_this->name]["hugePages"] = _this->hugePages;
+            config.release(true);
+        }
+        SmGui::SameLine();
+        if (SmGui::Checkbox(CONCAT("Lock Buffers##_rtlsdr_lockbufs_", _this->name), &_this->lockBuffers)) {
+            config.acquire();
+            config.conf["instances"][_this->name]["lockBuffers"] = _this->lockBuffers;
+            config.release(true);
+        }
         if (_this->running) { SmGui::EndDisabled(); }
 
+        if (_this->isReplay) {
+            SmGui::LeftLabel("Replay Pacing");
+            SmGui::FillWidth();
+            if (SmGui::Combo(CONCAT("##_rtlsdr_replaypacing_", _this->name), &_this->replayPacing, replayPacingTxt)) {
+                _this->saveReplayConfig();
+            }
+            if (SmGui::Checkbox(CONCAT("Loop##_rtlsdr_replayloop_", _this->name), &_this->replayLoop)) {
+                _this->saveReplayConfig();
+            }
+        }
+
+        if (_this->running) { SmGui::EndDisabled(); }
+
+        // Thread placement and priority can change while streaming
+        SmGui::LeftLabel("USB CPUs");
+        SmGui::FillWidth();
+        if (ImGui::InputText(CONCAT("##_rtlsdr_usb_cpus_", _this->name), _this->usbCpusTxt, sizeof(_this->usbCpusTxt))) {
+            if (affinity::parse(_this->usbCpusTxt, _this->usbCpus)) {
+                _this->saveSchedConfig();
+                if (_this->running) { _this->applyThreadSettings(); }
+            }
+        }
+
+        SmGui::LeftLabel("Converter CPUs");
+        SmGui::FillWidth();
+        if (ImGui::InputText(CONCAT("##_rtlsdr_conv_cpus_", _this->name), _this->convCpusTxt, sizeof(_this->convCpusTxt))) {
+            if (affinity::parse(_this->convCpusTxt, _this->convCpus)) {
+                _this->saveSchedConfig();
+                if (_this->running) { _this->applyThreadSettings(); }
+            }
+        }
+
+        SmGui::LeftLabel("Scheduling");
+        SmGui::FillWidth();
+        if (SmGui::Combo(CONCAT("##_rtlsdr_sched_", _this->name), &_this->schedPolicy, schedPoliciesTxt)) {
+            _this->saveSchedConfig();
+            if (_this->running) { _this->applyThreadSettings(); }
+        }
+
+        if (_this->schedPolicy != affinity::POLICY_NORMAL) {
+            SmGui::LeftLabel("Priority");
+            SmGui::FillWidth();
+            if (SmGui::SliderInt(CONCAT("##_rtlsdr_sched_prio_", _this->name), &_this->schedPriority, 1, 99)) {
+                _this->saveSchedConfig();
+                if (_this->running) { _this->applyThreadSettings(); }
+            }
+        }
+
+        if (_this->isReplay && _this->running) {
+            ReplayDevice* replayDev = (ReplayDevice*)_this->dev;
+            ReplayCall last;
+            ImGui::Text("%d device calls recorded", replayDev->getCallCount());
+            if (replayDev->getLastCall(last)) {
+                ImGui::Text("Last: %s(%lld)", last.call.c_str(), (long long)last.value);
+            }
+        }
+
         // Rest of rtlsdr config here
 
         if(_this->showIQ){
@@ -446,29 +960,22 @@ private:
         SmGui::FillWidth();
         if (SmGui::Combo(CONCAT("##_rtlsdr_ds_", _this->name), &_this->directSamplingMode, directSamplingModesTxt)) {
             if (_this->running) {
-                rtlsdr_set_direct_sampling(_this->openDev, _this->directSamplingMode);
-
-                // Update gains (fix for librtlsdr bug)
-                
-                if (_this->directSamplingMode == false) {
-
-                    rtlsdr_set_direct_sampling(_this->openDev, 1);
-                    rtlsdr_set_direct_sampling(_this->openDev, 0);
-                    rtlsdr_set_agc_mode(_this->openDev, _this->rtlAgc);
-
-                    if(_this->controlMode == 2)
-                    {
-                        int mode = 0;
-                        if (_this->agcModeId == 1){mode = 2;}
-                        rtlsdr_set_tuner_gain_mode(_this->openDev, mode);
-                    }
-                    else
-                    {
-                        rtlsdr_set_tuner_gain_mode(_this->openDev, 1);
+                int dsMode = _this->directSamplingMode;
+                bool rtlAgc = _this->rtlAgc;
+                int gainMode = (_this->controlMode != 2 || _this->agcModeId == 2) ? 1 : ((_this->agcModeId == 1) ? 2 : 0);
+                int gain = _this->getGain();
+                _this->executor.post(DEV_CMD_DIRECT_SAMPLING, [dsMode, rtlAgc, gainMode, gain](RTLDevice* dev) {
+                    dev->setDirectSampling(dsMode);
+
+                    // Update gains (fix for librtlsdr bug)
+                    if (dsMode == 0) {
+                        dev->setDirectSampling(1);
+                        dev->setDirectSampling(0);
+                        dev->setAgcMode(rtlAgc);
+                        dev->setTunerGainMode(gainMode);
+                        dev->setTunerGain(gain);
                     }
-                    rtlsdr_set_tuner_gain(_this->openDev, _this->gainList[_this->gainId]);
-                }
-                
+                });
             }
             if (_this->selectedDevName != "") {
                 config.acquire();
@@ -478,12 +985,20 @@ private:
         }
         }
 
+        // The calibration owns the correction while it runs
+        bool ppmLocked = _this->ppmCal.isActive();
+        if (ppmLocked) { SmGui::BeginDisabled(); }
         SmGui::LeftLabel("PPM Correction");
         SmGui::FillWidth();
         if (SmGui::InputInt(CONCAT("##_rtlsdr_ppm_", _this->name), &_this->ppm, 1, 10)) {
             _this->ppm = std::clamp<int>(_this->ppm, -1000000, 1000000);
             if (_this->running) {
-                rtlsdr_set_freq_correction(_this->openDev, _this->ppm);
+                int ppm = _this->ppm;
+                _this->executor.post(DEV_CMD_PPM, [ppm](RTLDevice* dev) { dev->setFreqCorrection(ppm); });
+            }
+            _this->ppmCal.setPpm(_this->ppm);
+            if (_this->recorder.isRecording()) {
+                _this->recorder.annotate("ppm " + std::to_string(_this->ppm));
             }
             if (_this->selectedDevName != "") {
                 config.acquire();
@@ -491,6 +1006,7 @@ private:
                 config.release(true);
             }
         }
+        if (ppmLocked) { SmGui::EndDisabled(); }
 
         // -------------------------------------------
 
@@ -499,9 +1015,9 @@ private:
         if (!_this->directSamplingMode){
 
         SmGui::Text("Tuner IF Frequency");
-        if (SmGui::InputInt(CONCAT("##_rtlsdr_iffreq", _this->name), &_this->if_freq_tuner,0)){rtlsdr_set_if_freq(_this->openDev, _this->if_freq_tuner);}
+        if (SmGui::InputInt(CONCAT("##_rtlsdr_iffreq", _this->name), &_this->if_freq_tuner,0)){_this->postIfFreq();}
         SmGui::SameLine();
-        if (SmGui::Button(CONCAT("Reset##_rtlsdr_ifreset", _this->name))){_this->if_freq_tuner = 3570000;rtlsdr_set_if_freq(_this->openDev, _this->if_freq_tuner);};
+        if (SmGui::Button(CONCAT("Reset##_rtlsdr_ifreset", _this->name))){_this->if_freq_tuner = 3570000;_this->postIfFreq();};
 
         }
 
@@ -511,36 +1027,30 @@ private:
         {
             if (_this->running)
             {
-                rtlsdr_set_tuner_sideband(_this->openDev, _this->sideband);
+                int sideband = _this->sideband;
+                _this->executor.post(DEV_CMD_SIDEBAND, [sideband](RTLDevice* dev) { dev->setTunerSideband(sideband); });
             }
         }
 
         if (_this->showGains)
         {
-            if(_this->running)
+            // Values come from the telemetry thread, no USB access from the UI
+            RTLSDRTelemetry tel = _this->telemetry.get();
+            if(_this->running && tel.valid)
             {
-                int current_dagc = rtlsdr_get_dagc_gain(_this->openDev);
-
-                float delta = (float)current_dagc - _this->rtl_dagc;
+                float delta = (float)tel.dagc - _this->rtl_dagc;
                 delta *= _this->io->DeltaTime * _this->tween_speed;
                 _this->rtl_dagc += delta;
-                
-
-                int current_strength = 0;
-                rtlsdr_get_tuner_i2c_register(_this->openDev, _this->tuner_register_read, &_this->len, &current_strength);
 
-                char mixerg = (_this->tuner_register_read[3] & 0xF0) >> 4;
-                char lnag = (_this->tuner_register_read[3] & 0x0F);
-
-                delta = (float)mixerg - _this->mixerGainRead;
+                delta = (float)tel.mixerGain - _this->mixerGainRead;
                 delta *= _this->io->DeltaTime * _this->tween_speed;
                 _this->mixerGainRead += delta;
 
-                delta = (float)lnag - _this->lnaGainRead;
+                delta = (float)tel.lnaGain - _this->lnaGainRead;
                 delta *= _this->io->DeltaTime * _this->tween_speed;
                 _this->lnaGainRead += delta;
 
-                delta = (float)current_strength - _this->strength;
+                delta = (float)tel.strength - _this->strength;
                 delta *= _this->io->DeltaTime * _this->tween_speed;
                 _this->strength += delta;
             }
@@ -564,11 +1074,8 @@ private:
 
         if (SmGui::RadioButton(CONCAT("Basic##_rtl_gm_", _this->name), _this->controlMode == 0)) {
             _this->controlMode = 0;
-            rtlsdr_set_tuner_gain_mode(_this->openDev, 1); // manual mod
-            rtlsdr_set_tuner_gain(_this->openDev, _this->gainList[_this->gainId]); // bug fix 
-
-            rtlsdr_set_tuner_i2c_register(_this->openDev, 0x05, 0x10, 0x00); // lna auto gain
-            rtlsdr_set_tuner_i2c_register(_this->openDev, 0x07, 0x10, 0x10); // mixer auto gain
+            _this->postControlMode();
+            _this->annotateGains();
         }
 
         SmGui::NextColumn();
@@ -576,18 +1083,8 @@ private:
 
         if (SmGui::RadioButton(CONCAT("Manual##_rtl_gm_", _this->name), _this->controlMode == 1)) {
             _this->controlMode = 1;
-            rtlsdr_set_tuner_gain_mode(_this->openDev, 1); // manual mod
-            rtlsdr_set_tuner_gain(_this->openDev, _this->gainList[_this->gainId]); // bug fix 
-
-        
-
-            rtlsdr_set_tuner_i2c_register(_this->openDev, 0x05, 0x10, 0x10); // lna manual gain
-            rtlsdr_set_tuner_i2c_register(_this->openDev, 0x07, 0x10, 0x00); // mixer manual gain
-
-            rtlsdr_set_tuner_i2c_register(_this->openDev, 0x05, 0x0F, _this->lnaGain);
-            rtlsdr_set_tuner_i2c_register(_this->openDev, 0x07, 0x0F, _this->mixerGain);
-            rtlsdr_set_tuner_gain_index(_this->openDev, _this->vgaGain);
-            
+            _this->postControlMode();
+            _this->annotateGains();
         }
 
         SmGui::NextColumn();
@@ -595,21 +1092,8 @@ private:
 
         if (SmGui::RadioButton(CONCAT("AGC##_rtl_gm_", _this->name), _this->controlMode == 2)) {
             _this->controlMode = 2;
-
-            rtlsdr_set_tuner_gain(_this->openDev, _this->gainList[_this->gainId]); // bug fix 
-
-            rtlsdr_set_tuner_i2c_register(_this->openDev, 0x05, 0x10, 0x00); // lna auto gain
-            rtlsdr_set_tuner_i2c_register(_this->openDev, 0x07, 0x10, 0x10); // mixer auto gain
-
-            
-            if (_this->agcModeId == 0) // hardware
-            {
-                rtlsdr_set_tuner_gain_mode(_this->openDev, 0);
-            }
-            else // software
-            {
-                rtlsdr_set_tuner_gain_mode(_this->openDev, 2);
-            }
+            _this->postControlMode();
+            _this->annotateGains();
         }
 
         SmGui::Columns(1, CONCAT("EndRtlSdrModeColumns##_", _this->name), false);
@@ -627,8 +1111,10 @@ private:
             if (ImGui::SliderInt(CONCAT("##_rtlsdr_gain_", _this->name), &_this->gainId, 0, _this->gainList.size() - 1, _this->dbTxt)) {
             _this->updateGainTxt();
             if (_this->running) {
-                rtlsdr_set_tuner_gain(_this->openDev, _this->gainList[_this->gainId]);
+                int gain = _this->getGain();
+                _this->executor.post(DEV_CMD_GAIN, [gain](RTLDevice* dev) { dev->setTunerGain(gain); });
             }
+            _this->annotateGains();
             }
         }
         else if (_this->controlMode == 1)
@@ -638,7 +1124,8 @@ private:
             if (ImGui::SliderInt(CONCAT("##_rtlsdr_lnagain_", _this->name), &_this->lnaGain, 0, 15, _this->lnaGainTxt)) 
             {
                 sprintf(_this->lnaGainTxt, "%i", _this->lnaGain);
-                rtlsdr_set_tuner_i2c_register(_this->openDev, 0x05, 0x0F, _this->lnaGain);
+                _this->postTunerReg(0x05, 0x0F, _this->lnaGain);
+                _this->annotateGains();
             }
 
             SmGui::LeftLabel("Mixer Gain");
@@ -646,7 +1133,8 @@ private:
             if (ImGui::SliderInt(CONCAT("##_rtlsdr_mixergain_", _this->name), &_this->mixerGain, 0, 15, _this->mixerGainTxt)) 
             {
                 sprintf(_this->mixerGainTxt, "%i", _this->mixerGain);
-                rtlsdr_set_tuner_i2c_register(_this->openDev, 0x07, 0x0F, _this->mixerGain);
+                _this->postTunerReg(0x07, 0x0F, _this->mixerGain);
+                _this->annotateGains();
             }
 
             SmGui::LeftLabel("Vga Gain");
@@ -654,7 +1142,9 @@ private:
             if (ImGui::SliderInt(CONCAT("##_rtlsdr_vgagain_", _this->name), &_this->vgaGain, 0, 15, _this->vgaGainTxt))
             {
                 sprintf(_this->vgaGainTxt, "%.1f dB", -12.0 + (_this->vgaGain * 3.5));
-                rtlsdr_set_tuner_gain_index(_this->openDev, _this->vgaGain);
+                int vgaGain = _this->vgaGain;
+                _this->executor.post(DEV_CMD_VGA_GAIN, [vgaGain](RTLDevice* dev) { dev->setTunerGainIndex(vgaGain); });
+                _this->annotateGains();
             }
 
             // filters
@@ -663,7 +1153,7 @@ private:
             SmGui::FillWidth();
             if (ImGui::SliderInt(CONCAT("##_rtlsdr_lpfcut_", _this->name), &_this->lpfCutoff, 0, 15))
             {
-                rtlsdr_set_tuner_i2c_register(_this->openDev, 0x1B, 15 , 15 - _this->lpfCutoff);
+                _this->postTunerReg(0x1B, 15 , 15 - _this->lpfCutoff);
             }
             if (ImGui::IsItemHovered(ImGuiHoveredFlags_AllowWhenDisabled))
             {
@@ -674,7 +1164,7 @@ private:
             SmGui::FillWidth();
             if (ImGui::SliderInt(CONCAT("##_rtlsdr_lpnfcut_", _this->name), &_this->lpnfCutoff, 0, 15))
             {
-                rtlsdr_set_tuner_i2c_register(_this->openDev, 0x1B, 240 , (15 - _this->lpnfCutoff) << 4);
+                _this->postTunerReg(0x1B, 240 , (15 - _this->lpnfCutoff) << 4);
             }
             if (ImGui::IsItemHovered(ImGuiHoveredFlags_AllowWhenDisabled))
             {
@@ -685,7 +1175,7 @@ private:
             SmGui::FillWidth();
             if (ImGui::SliderInt(CONCAT("##_rtlsdr_hpfcut_", _this->name), &_this->hpfCutoff, 0, 15))
             { 
-                rtlsdr_set_tuner_i2c_register(_this->openDev, 0x0B, 15 , 15 - _this->hpfCutoff);
+                _this->postTunerReg(0x0B, 15 , 15 - _this->hpfCutoff);
             }
             if (ImGui::IsItemHovered(ImGuiHoveredFlags_AllowWhenDisabled))
             {
@@ -702,13 +1192,31 @@ private:
             SmGui::ForceSync();
             if (SmGui::Combo(CONCAT("##_rtlsdr_agcmode_", _this->name), &_this->agcModeId, agcModesTxt))
             {
-                if (_this->agcModeId == 0) // hardware
-                {
-                    rtlsdr_set_tuner_gain_mode(_this->openDev, 0);
-                }
-                else // software
-                {
-                    rtlsdr_set_tuner_gain_mode(_this->openDev, 2);
+                _this->postControlMode();
+                _this->annotateGains();
+            }
+
+            if (_this->agcModeId == 2)
+            {
+                bool changed = false;
+                SmGui::LeftLabel("Target (dBFS)");
+                SmGui::FillWidth();
+                changed |= ImGui::SliderFloat(CONCAT("##_rtlsdr_sagctarget_", _this->name), &_this->softAgcTarget, -40.0f, -1.0f, "%.1f");
+                SmGui::LeftLabel("Attack (ms)");
+                SmGui::FillWidth();
+                changed |= ImGui::SliderFloat(CONCAT("##_rtlsdr_sagcattack_", _this->name), &_this->softAgcAttack, 0.1f, 1000.0f, "%.1f", ImGuiSliderFlags_Logarithmic);
+                SmGui::LeftLabel("Decay (ms)");
+                SmGui::FillWidth();
+                changed |= ImGui::SliderFloat(CONCAT("##_rtlsdr_sagcdecay_", _this->name), &_this->softAgcDecay, 1.0f, 10000.0f, "%.0f", ImGuiSliderFlags_Logarithmic);
+                SmGui::LeftLabel("Hysteresis (dB)");
+                SmGui::FillWidth();
+                changed |= ImGui::SliderFloat(CONCAT("##_rtlsdr_sagchyst_", _this->name), &_this->softAgcHysteresis, 0.5f, 10.0f, "%.1f");
+                if (changed) { _this->saveSoftAgcConfig(); }
+
+                if (_this->running) {
+                    SoftAgcGains g = SoftAgc::stepGains(_this->softAgc.getStep());
+                    ImGui::Text("Level %.1f dBFS, clipping %.3f%%", _this->softAgc.getLevel(), _this->softAgc.getClipping() * 100.0);
+                    ImGui::Text("LNA %d  Mixer %d  VGA %d", g.lna, g.mixer, g.vga);
                 }
             }
         }
@@ -725,7 +1233,7 @@ private:
         SmGui::FillWidth();
         if (ImGui::SliderInt(CONCAT("##_rtlsdr_filterbw_", _this->name), &_this->filterBw, 0, 15))
         {
-            rtlsdr_set_tuner_i2c_register(_this->openDev, 0x0A, 15, _this->filterBw);
+            _this->postTunerReg(0x0A, 15, _this->filterBw);
         }
         if (ImGui::IsItemHovered(ImGuiHoveredFlags_AllowWhenDisabled))
         {
@@ -736,7 +1244,7 @@ private:
         SmGui::FillWidth();
         if (ImGui::SliderInt(CONCAT("##_rtlsdr_lpfcut_", _this->name), &_this->lpfCutoff, 0, 15))
         {
-            rtlsdr_set_tuner_i2c_register(_this->openDev, 0x1B, 15 , 15 - _this->lpfCutoff);
+            _this->postTunerReg(0x1B, 15 , 15 - _this->lpfCutoff);
         }
         if (ImGui::IsItemHovered(ImGuiHoveredFlags_AllowWhenDisabled))
         {
@@ -747,7 +1255,7 @@ private:
         SmGui::FillWidth();
         if (ImGui::SliderInt(CONCAT("##_rtlsdr_lpnfcut_", _this->name), &_this->lpnfCutoff, 0, 15))
         {
-            rtlsdr_set_tuner_i2c_register(_this->openDev, 0x1B, 240 , (15 - _this->lpnfCutoff) << 4);
+            _this->postTunerReg(0x1B, 240 , (15 - _this->lpnfCutoff) << 4);
         }
         if (ImGui::IsItemHovered(ImGuiHoveredFlags_AllowWhenDisabled))
         {
@@ -758,7 +1266,7 @@ private:
         SmGui::FillWidth();
         if (ImGui::SliderInt(CONCAT("##_rtlsdr_hpfcut_", _this->name), &_this->hpfCutoff, 0, 15))
         { 
-            rtlsdr_set_tuner_i2c_register(_this->openDev, 0x0B, 15 , 15 - _this->hpfCutoff);
+            _this->postTunerReg(0x0B, 15 , 15 - _this->hpfCutoff);
         }
         if (ImGui::IsItemHovered(ImGuiHoveredFlags_AllowWhenDisabled))
         {
@@ -773,7 +1281,7 @@ private:
         SmGui::FillWidth();
         if (SmGui::Combo(CONCAT("##_rtlsdr_agclock_", _this->name), &_this->agcClockId, agcClockTxt)) 
         {
-            rtlsdr_set_tuner_i2c_register(_this->openDev, 0x1A, 48, _this->agcClockId+1 << 4);
+            _this->postTunerReg(0x1A, 48, _this->agcClockId+1 << 4);
         }
 
 
@@ -783,7 +1291,8 @@ private:
 
         if (SmGui::Checkbox(CONCAT("Bias T##_rtlsdr_rtl_biast_", _this->name), &_this->biasT)) {
             if (_this->running) {
-                rtlsdr_set_bias_tee(_this->openDev, _this->biasT);
+                bool biasT = _this->biasT;
+                _this->executor.post(DEV_CMD_BIAS_T, [biasT](RTLDevice* dev) { dev->setBiasTee(biasT); });
             }
             if (_this->selectedDevName != "") {
                 config.acquire();
@@ -794,7 +1303,8 @@ private:
 
         if (SmGui::Checkbox(CONCAT("Offset Tuning##_rtlsdr_rtl_ofs_", _this->name), &_this->offsetTuning)) {
             if (_this->running) {
-                rtlsdr_set_offset_tuning(_this->openDev, _this->offsetTuning);
+                bool offsetTuning = _this->offsetTuning;
+                _this->executor.post(DEV_CMD_OFFSET_TUNING, [offsetTuning](RTLDevice* dev) { dev->setOffsetTuning(offsetTuning); });
             }
             if (_this->selectedDevName != "") {
                 config.acquire();
@@ -803,9 +1313,31 @@ private:
             }
         }
 
+        if (SmGui::Checkbox(CONCAT("DC Correction##_rtlsdr_dccor_", _this->name), &_this->dcCorrection)) {
+            if (_this->selectedDevName != "") {
+                config.acquire();
+                config.conf["devices"][_this->selectedDevName]["dcCorrection"] = _this->dcCorrection;
+                config.release(true);
+            }
+        }
+
+        if (SmGui::Checkbox(CONCAT("IQ Correction##_rtlsdr_iqcor_", _this->name), &_this->iqCorrection)) {
+            if (_this->selectedDevName != "") {
+                config.acquire();
+                config.conf["devices"][_this->selectedDevName]["iqCorrection"] = _this->iqCorrection;
+                config.release(true);
+            }
+        }
+
+        if (_this->running && (_this->dcCorrection || _this->iqCorrection)) {
+            ImGui::Text("DC %.4f/%.4f  IQ %.2fdB %.2f deg", _this->corrector.getDcI(), _this->corrector.getDcQ(),
+                        _this->corrector.getGainError(), _this->corrector.getPhaseError());
+        }
+
         if (SmGui::Checkbox(CONCAT("RTL AGC##_rtlsdr_rtl_agc_", _this->name), &_this->rtlAgc)) {
             if (_this->running) {
-                rtlsdr_set_agc_mode(_this->openDev, _this->rtlAgc);
+                bool rtlAgc = _this->rtlAgc;
+                _this->executor.post(DEV_CMD_RTL_AGC, [rtlAgc](RTLDevice* dev) { dev->setAgcMode(rtlAgc); });
             }
             if (_this->selectedDevName != "") {
                 config.acquire();
@@ -816,6 +1348,237 @@ private:
 
         if (SmGui::Checkbox(CONCAT("Show Gains##_rtlsdr_showgains", _this->name), &_this->showGains));
 
+        if (SmGui::Checkbox(CONCAT("Fast Tune##_rtlsdr_fasttune_", _this->name), &_this->fastTune)) {
+            config.acquire();
+            config.conf["instances"][_this->name]["fastTune"] = _this->fastTune;
+            config.release(true);
+        }
+
+        if (SmGui::Checkbox(CONCAT("ADC Statistics##_rtlsdr_adcstats_", _this->name), &_this->adcStatsOn)) {
+            config.acquire();
+            config.conf["instances"][_this->name]["adcStats"] = _this->adcStatsOn;
+            config.release(true);
+        }
+
+        if (_this->serverMode) {
+            char rawTxt[64];
+            snprintf(rawTxt, sizeof(rawTxt), "Raw Sinks: %d", _this->rawTap.getCount());
+            SmGui::Text(rawTxt);
+        }
+
+        if (SmGui::Checkbox(CONCAT("Warm Standby##_rtlsdr_warmstandby_", _this->name), &_this->warmStandby)) {
+            if (!_this->warmStandby) { _this->closeStandby(); }
+            config.acquire();
+            config.conf["instances"][_this->name]["warmStandby"] = _this->warmStandby;
+            config.release(true);
+        }
+
+        SmGui::LeftLabel("Settling");
+        SmGui::FillWidth();
+        if (SmGui::Combo(CONCAT("##_rtlsdr_settlemode_", _this->name), &_this->settleMode, settleModesTxt)) {
+            _this->tracker.setMode(_this->settleMode);
+            config.acquire();
+            config.conf["instances"][_this->name]["settleMode"] = _this->settleMode;
+            config.release(true);
+        }
+        char settleTxt[64];
+        snprintf(settleTxt, sizeof(settleTxt), _this->measuringSettle ? "Settle Time: measuring..." : "Settle Time: %.2f ms", _this->settleTime * 1000.0);
+        SmGui::Text(settleTxt);
+        bool canMeasure = _this->running && !_this->tunerBusy();
+        if (!canMeasure) { SmGui::BeginDisabled(); }
+        SmGui::SameLine();
+        if (SmGui::Button(CONCAT("Measure##_rtlsdr_settlemeas_", _this->name))) {
+            if (_this->settleThread.joinable()) { _this->settleThread.join(); }
+            _this->measuringSettle = true;
+            _this->settleThread = std::thread(&RTLSDRSourceModule::measureSettleTime, _this, _this->freq);
+        }
+        if (!canMeasure) { SmGui::EndDisabled(); }
+
+        SmGui::LeftLabel("Telemetry Rate (Hz)");
+        SmGui::FillWidth();
+        if (SmGui::InputInt(CONCAT("##_rtlsdr_telrate_", _this->name), &_this->telemetryRate, 1, 10)) {
+            _this->telemetryRate = std::clamp<int>(_this->telemetryRate, 0, TELEMETRY_MAX_RATE);
+            _this->telemetry.setRate(_this->telemetryRate);
+            config.acquire();
+            config.conf["instances"][_this->name]["telemetryRate"] = _this->telemetryRate;
+            config.release(true);
+        }
+
+        if (ImGui::CollapsingHeader(CONCAT("Raw Recording##_rtlsdr_rawrecheader", _this->name))) {
+            bool recording = _this->recorder.isRecording();
+            if (recording) { SmGui::BeginDisabled(); }
+            SmGui::LeftLabel("Folder");
+            SmGui::FillWidth();
+            if (ImGui::InputText(CONCAT("##_rtlsdr_rawrecpath_", _this->name), _this->rawRecPath, sizeof(_this->rawRecPath))) {
+                config.acquire();
+                config.conf["rawRecordPath"] = std::string(_this->rawRecPath);
+                config.release(true);
+            }
+            if (recording) { SmGui::EndDisabled(); }
+
+            if (!_this->running) { SmGui::BeginDisabled(); }
+            SmGui::FillWidth();
+            if (!recording && SmGui::Button(CONCAT("Record CU8##_rtlsdr_rawrec_", _this->name))) {
+                _this->startRawRecording();
+            }
+            else if (recording && SmGui::Button(CONCAT("Stop##_rtlsdr_rawrec_", _this->name))) {
+                _this->stopRawRecording();
+            }
+            if (!_this->running) { SmGui::EndDisabled(); }
+
+            if (recording) {
+                ImGui::Text("%.1f MB written, %.1f MB dropped", (double)_this->recorder.getWrittenBytes() / 1e6, (double)_this->recorder.getDroppedBytes() / 1e6);
+            }
+        }
+
+        if (ImGui::CollapsingHeader(CONCAT("Sweep##_rtlsdr_sweepheader", _this->name))) {
+            bool sweeping = _this->sweeper.isRunning();
+            bool changed = false;
+            if (sweeping) { SmGui::BeginDisabled(); }
+            SmGui::LeftLabel("Ranges");
+            SmGui::FillWidth();
+            changed |= ImGui::InputText(CONCAT("##_rtlsdr_sweepranges_", _this->name), _this->sweepRangesTxt, sizeof(_this->sweepRangesTxt));
+            SmGui::LeftLabel("FFT Size");
+            SmGui::FillWidth();
+            changed |= SmGui::Combo(CONCAT("##_rtlsdr_sweepfft_", _this->name), &_this->sweepFftSizeId, sweepFftSizesTxt);
+            SmGui::LeftLabel("Dwell (ms)");
+            SmGui::FillWidth();
+            changed |= SmGui::InputInt(CONCAT("##_rtlsdr_sweepdwell_", _this->name), &_this->sweepDwell, 10, 100);
+            SmGui::LeftLabel("Settle (ms)");
+            SmGui::FillWidth();
+            changed |= SmGui::InputInt(CONCAT("##_rtlsdr_sweepsettle_", _this->name), &_this->sweepSettle, 1, 10);
+            SmGui::LeftLabel("Output");
+            SmGui::FillWidth();
+            changed |= SmGui::Combo(CONCAT("##_rtlsdr_sweepfmt_", _this->name), &_this->sweepFormat, sweepFormatsTxt);
+            changed |= SmGui::Checkbox(CONCAT("Loop##_rtlsdr_sweeploop_", _this->name), &_this->sweepLoop);
+            if (sweeping) { SmGui::EndDisabled(); }
+            if (changed) {
+                _this->sweepDwell = std::clamp<int>(_this->sweepDwell, 1, 60000);
+                _this->sweepSettle = std::clamp<int>(_this->sweepSettle, 0, 10000);
+                _this->saveSweepConfig();
+            }
+
+            if (!_this->running) { SmGui::BeginDisabled(); }
+            SmGui::FillWidth();
+            if (!sweeping && !_this->tunerBusy() && SmGui::Button(CONCAT("Start Sweep##_rtlsdr_sweep_", _this->name))) {
+                _this->startSweep();
+            }
+            else if (sweeping && SmGui::Button(CONCAT("Stop Sweep##_rtlsdr_sweep_", _this->name))) {
+                _this->sweeper.stop();
+            }
+            if (!_this->running) { SmGui::EndDisabled(); }
+
+            if (sweeping) {
+                ImGui::Text("Hop %d/%d, %llu sweeps done", _this->sweeper.getHop() + 1, _this->sweeper.getHopCount(), (unsigned long long)_this->sweeper.getSweeps());
+            }
+            if (_this->sweeper.getSweeps()) {
+                ImGui::Text("Last sweep took %.2fs", _this->sweeper.getLastSweepTime());
+            }
+        }
+
+        if (ImGui::CollapsingHeader(CONCAT("PPM Calibration##_rtlsdr_ppmcalheader", _this->name))) {
+            bool calibrating = _this->ppmCal.isRunning();
+            bool changed = false;
+            if (calibrating) { SmGui::BeginDisabled(); }
+            double refMHz = _this->ppmCalRef / 1e6;
+            SmGui::LeftLabel("Reference (MHz)");
+            SmGui::FillWidth();
+            if (ImGui::InputDouble(CONCAT("##_rtlsdr_ppmcalref_", _this->name), &refMHz, 0.0, 0.0, "%.6f")) {
+                _this->ppmCalRef = std::clamp<double>(refMHz * 1e6, 0.0, 2e9);
+                changed = true;
+            }
+            SmGui::LeftLabel("Dwell (ms)");
+            SmGui::FillWidth();
+            changed |= SmGui::InputInt(CONCAT("##_rtlsdr_ppmcaldwell_", _this->name), &_this->ppmCalDwell, 10, 100);
+            SmGui::LeftLabel("Repeat (min)");
+            SmGui::FillWidth();
+            changed |= SmGui::InputInt(CONCAT("##_rtlsdr_ppmcalint_", _this->name), &_this->ppmCalInterval, 1, 10);
+            if (calibrating) { SmGui::EndDisabled(); }
+            if (changed) {
+                _this->ppmCalDwell = std::clamp<int>(_this->ppmCalDwell, 10, 10000);
+                _this->ppmCalInterval = std::clamp<int>(_this->ppmCalInterval, 0, 1440);
+                config.acquire();
+                config.conf["instances"][_this->name]["ppmCal"]["refFreq"] = _this->ppmCalRef;
+                config.conf["instances"][_this->name]["ppmCal"]["dwell"] = _this->ppmCalDwell;
+                config.conf["instances"][_this->name]["ppmCal"]["interval"] = _this->ppmCalInterval;
+                config.release(true);
+            }
+
+            bool canCalibrate = _this->running && _this->ppmCalRef > 0.0;
+            if (!canCalibrate) { SmGui::BeginDisabled(); }
+            SmGui::FillWidth();
+            if (!calibrating && !_this->tunerBusy() && SmGui::Button(CONCAT("Calibrate##_rtlsdr_ppmcal_", _this->name))) {
+                _this->startPpmCalibration(_this->ppmCalRef);
+            }
+            else if (calibrating && SmGui::Button(CONCAT("Stop##_rtlsdr_ppmcal_", _this->name))) {
+                _this->ppmCal.stop();
+            }
+            if (!canCalibrate) { SmGui::EndDisabled(); }
+
+            RTLSDRPpmCalibration pc = _this->ppmCal.get();
+            if (pc.active) {
+                ImGui::Text("Measuring...");
+            }
+            else if (pc.runs) {
+                ImGui::Text("%s: %d ppm, residual %.2f ppm, %.1f dB SNR", pc.ok ? "Calibrated" : "Failed", pc.ppm, pc.error, pc.snr);
+            }
+        }
+
+        if (ImGui::CollapsingHeader(CONCAT("Statistics##_rtlsdr_statheader", _this->name))) {
+            RTLSDRStreamStats st = _this->stats.get();
+            ImGui::Text("Dropped: %llu blocks (%llu samples)", (unsigned long long)st.droppedBlocks, (unsigned long long)st.droppedSamples);
+            ImGui::Text("USB Overflows: %llu (~%llu samples)", (unsigned long long)st.usbOverflows, (unsigned long long)st.overflowSamples);
+            ImGui::Text("Late Callbacks: %llu", (unsigned long long)st.lateCallbacks);
+            RTLSDRJitterStats js = _this->stats.getJitter();
+            if (js.count) {
+                ImGui::Text("Callback Jitter: p50 %.0fus, p99 %.0fus, max %.0fus", js.p50, js.p99, js.max);
+            }
+            if (_this->running) {
+                TunerRegs& regs = _this->dev->getTunerRegs();
+                ImGui::Text("Tuner Writes: %llu (%llu skipped)", (unsigned long long)regs.getWrites(), (unsigned long long)regs.getSkipped());
+            }
+            if (st.lastGapTime) {
+                int64_t now = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::system_clock::now().time_since_epoch()).count();
+                ImGui::Text("Last Gap: %.1fs ago", (double)(now - st.lastGapTime) / 1000.0);
+            }
+            else {
+                ImGui::Text("Last Gap: None");
+            }
+            if (_this->firstSampleTime >= 0.0) {
+                ImGui::Text("First Sample: %.1fms (%s start)", (double)_this->firstSampleTime, _this->warmStart ? "warm" : "cold");
+            }
+            if (_this->running && (_this->adcStatsOn || _this->softAgcOn)) {
+                RTLSDRAdcStats ast = _this->adcStats.get();
+                ImGui::Text("ADC Clipping: I %.3f%% Q %.3f%%", ast.clipI * 100.0, ast.clipQ * 100.0);
+                ImGui::Text("ADC RMS: %.1f dBFS, %.2f effective bits", ast.rms, ast.effectiveBits);
+                ImGui::Text("ADC Mean: I %.2f Q %.2f", ast.meanI, ast.meanQ);
+                float hist[256];
+                for (int i = 0; i < 256; i++) { hist[i] = log10f(1.0f + (float)ast.histI[i] + (float)ast.histQ[i]); }
+                ImGui::PlotLines(CONCAT("##_rtlsdr_adchist_", _this->name), hist, 256, 0, NULL, 0.0f, FLT_MAX, ImVec2(0, 60));
+            }
+            if (_this->running) {
+                RTLSDRBufferStats bs = _this->getBufferStats();
+                ImGui::Text("Buffer Pool: %.2f MB%s%s, %.2f MB used", (double)bs.poolBytes / 1e6, bs.hugePages ? ", huge pages" : "",
+                            bs.locked ? ", locked" : "", (double)bs.usedBytes / 1e6);
+                ImGui::Text("Ring: %d/%d slots, peak %d", bs.ringOccupancy, bs.ringSlots, bs.ringHighWater);
+            }
+            if (_this->running && _this->dev->isRealtime()) {
+                RTLSDRClockState cs = _this->sampleClock.get();
+                ImGui::Text("Sample Clock: %+.2f ppm%s, jitter %.0fus", cs.ppm, cs.locked ? "" : " (locking)", cs.jitter);
+                ImGui::Text("Clock Discontinuities: %llu", (unsigned long long)cs.discontinuities);
+            }
+            RTLSDRCommandStats cst = _this->executor.getTotalStats();
+            ImGui::Text("Commands: p50 %.2fms p99 %.2fms (%llu, %llu coalesced)", cst.p50 / 1000.0, cst.p99 / 1000.0, (unsigned long long)cst.count, (unsigned long long)cst.coalesced);
+            RTLSDRTuneStats tst = _this->getTuneStats();
+            ImGui::Text("Retune: p50 %.2fms p99 %.2fms (%llu)", tst.p50 / 1000.0, tst.p99 / 1000.0, (unsigned long long)tst.count);
+            ImGui::Text("Retune Retries: %llu, Failures: %llu", (unsigned long long)tst.retries, (unsigned long long)tst.failures);
+            if (ImGui::Button(CONCAT("Reset##_rtlsdr_statreset", _this->name))) {
+                _this->stats.clear();
+                _this->clearTuneStats();
+                _this->executor.clearStats();
+            }
+        }
+
         /*
         if (!_this->running) {SmGui::BeginDisabled();}
 
@@ -826,26 +1589,26 @@ private:
             SmGui::FillWidth();
             if (SmGui::Combo(CONCAT("##_rtlsdr_rfreject_", _this->name), &_this->rfReject3rdId, rfFilterRejectTxt)) 
             {
-                rtlsdr_set_tuner_i2c_register(_this->openDev, 0x1A, 3, _this->rfReject3rdId);
+                _this->postTunerReg(0x1A, 3, _this->rfReject3rdId);
             }
 
             SmGui::LeftLabel("Tracking Filter");
             SmGui::FillWidth();
             if (SmGui::Combo(CONCAT("##_rtlsdr_trackfil_", _this->name), &_this->trackFiltId, trackingFilterTxt)) 
             {
-                rtlsdr_set_tuner_i2c_register(_this->openDev, 0x1A, 64, 64 * _this->trackFiltId);
+                _this->postTunerReg(0x1A, 64, 64 * _this->trackFiltId);
             }
 
             if (SmGui::Checkbox(CONCAT("Tracking Fil. Q##rtlsdr_qenhanc", _this->name), &_this->trackFilQ))
             {
-                rtlsdr_set_tuner_i2c_register(_this->openDev, 0x00, 128 , 128 * _this->trackFilQ);
+                _this->postTunerReg(0x00, 128 , 128 * _this->trackFilQ);
             }
 
             SmGui::LeftLabel("Channel filter Q");
             SmGui::FillWidth();
             if (SmGui::Combo(CONCAT("##_rtlsdr_chanfilq_", _this->name), &_this->channelFilQId, channelFilQTxt)) 
             {
-                rtlsdr_set_tuner_i2c_register(_this->openDev, 0x02, 64 , 64 * _this->channelFilQId);
+                _this->postTunerReg(0x02, 64 , 64 * _this->channelFilQId);
             }
 
 
@@ -856,14 +1619,14 @@ private:
             SmGui::FillWidth();
             if (SmGui::SliderInt(CONCAT("##_rtlsdr_pdet2top", _this->name), &_this->pdet2TOP , 0, 7))
             {
-                rtlsdr_set_tuner_i2c_register(_this->openDev, 0x1D, 63 , (_this->pdet1TOP << 3)+_this->pdet2TOP);
+                _this->postTunerReg(0x1D, 63 , (_this->pdet1TOP << 3)+_this->pdet2TOP);
             }
 
             SmGui::LeftLabel("WideBand TOP");
             SmGui::FillWidth();
             if (SmGui::SliderInt(CONCAT("##_rtlsdr_pdet1top", _this->name), &_this->pdet1TOP , 0, 7))
             {
-                rtlsdr_set_tuner_i2c_register(_this->openDev, 0x1D, 63 , (_this->pdet1TOP << 3)+_this->pdet2TOP);
+                _this->postTunerReg(0x1D, 63 , (_this->pdet1TOP << 3)+_this->pdet2TOP);
             }
 
             SmGui::Text("Agc Thresholds");
@@ -872,7 +1635,7 @@ private:
             if (ImGui::SliderInt(CONCAT("##_rtlsdr_lnaagclow", _this->name), &_this->lnaAgcPdetVoltageTreshLow , 0, 15, _this->lnaAgcPdetLow))
             {
                 sprintf(_this->lnaAgcPdetLow, "~%.2fV",0.34f+(0.1f *  _this->lnaAgcPdetVoltageTreshLow));
-                rtlsdr_set_tuner_i2c_register(_this->openDev, 0x0D, 15, _this->lnaAgcPdetVoltageTreshLow);
+                _this->postTunerReg(0x0D, 15, _this->lnaAgcPdetVoltageTreshLow);
             }
 
             SmGui::LeftLabel("High");
@@ -880,7 +1643,7 @@ private:
             if (ImGui::SliderInt(CONCAT("##_rtlsdr_lnaagchigh", _this->name), &_this->lnaAgcPdetVoltageTreshHigh , 0, 15, _this->lnaAgcPdetHigh))
             {
                 sprintf(_this->lnaAgcPdetHigh, "~%.2fV", 0.34f+(0.1f * _this->lnaAgcPdetVoltageTreshHigh));
-                rtlsdr_set_tuner_i2c_register(_this->openDev, 0x0D, 240, _this->lnaAgcPdetVoltageTreshHigh << 4);
+                _this->postTunerReg(0x0D, 240, _this->lnaAgcPdetVoltageTreshHigh << 4);
             }
 
             ImGui::NewLine();
@@ -890,7 +1653,7 @@ private:
             SmGui::FillWidth();
             if (SmGui::SliderInt(CONCAT("##_rtlsdr_pdet3top", _this->name), &_this->pdet3TOP , 0, 15))
             {
-                rtlsdr_set_tuner_i2c_register(_this->openDev, 0x1C, 240 , _this->pdet3TOP << 4);
+                _this->postTunerReg(0x1C, 240 , _this->pdet3TOP << 4);
             }
 
             SmGui::Text("Agc Thresholds");
@@ -899,7 +1662,7 @@ private:
             if (ImGui::SliderInt(CONCAT("##_rtlsdr_mixeragclow", _this->name), &_this->mixerAgcPdetVoltageTreshLow , 0, 15, _this->mixerAgcPdetLow))
             {
                 sprintf(_this->mixerAgcPdetLow, "~%.2fV", 0.34f+(0.1f * _this->mixerAgcPdetVoltageTreshLow));
-                rtlsdr_set_tuner_i2c_register(_this->openDev, 0x0E, 15, _this->mixerAgcPdetVoltageTreshLow);
+                _this->postTunerReg(0x0E, 15, _this->mixerAgcPdetVoltageTreshLow);
             }
 
             SmGui::LeftLabel("High");
@@ -907,7 +1670,7 @@ private:
             if (ImGui::SliderInt(CONCAT("##_rtlsdr_mixeragchigh", _this->name), &_this->mixerAgcPdetVoltageTreshHigh , 0, 15, _this->mixerAgcPdetHigh))
             {
                 sprintf(_this->mixerAgcPdetHigh, "~%.2fV", 0.34f+(0.1f * _this->mixerAgcPdetVoltageTreshHigh));
-                rtlsdr_set_tuner_i2c_register(_this->openDev, 0x0E, 240 , _this->mixerAgcPdetVoltageTreshHigh << 4);
+                _this->postTunerReg(0x0E, 240 , _this->mixerAgcPdetVoltageTreshHigh << 4);
             }
 
             ImGui::NewLine();
@@ -917,28 +1680,28 @@ private:
             SmGui::FillWidth();
             if (SmGui::Combo(CONCAT("##_rtlsdr_mixercurcon_", _this->name), &_this->mixerCurrentControlId, mixerCurrentControlTxt)) 
             {
-                rtlsdr_set_tuner_i2c_register(_this->openDev, 0x07, 32 , 32 * _this->mixerCurrentControlId);
+                _this->postTunerReg(0x07, 32 , 32 * _this->mixerCurrentControlId);
             }
 
             SmGui::LeftLabel("Mixer Buffer Current");
             SmGui::FillWidth();
             if (SmGui::Combo(CONCAT("##_rtlsdr_mixerbufcur_", _this->name), &_this->mixerBufferCurrentId, mixerBufferCurrentTxt)) 
             {
-                rtlsdr_set_tuner_i2c_register(_this->openDev, 0x08, 64 , 64 * _this->mixerBufferCurrentId);
+                _this->postTunerReg(0x08, 64 , 64 * _this->mixerBufferCurrentId);
             }
 
             SmGui::LeftLabel("VGA Power");
             SmGui::FillWidth();
             if (SmGui::Combo(CONCAT("##_rtlsdr_vgapowerlevel_", _this->name), &_this->vgaPowerLevelId, vgaPowerLevelTxt)) 
             {
-                rtlsdr_set_tuner_i2c_register(_this->openDev, 0x0C, 32 , 32 * _this->vgaPowerLevelId);
+                _this->postTunerReg(0x0C, 32 , 32 * _this->vgaPowerLevelId);
             }
 
             SmGui::LeftLabel("AGC Pin");
             SmGui::FillWidth();
             if (SmGui::Combo(CONCAT("##_rtlsdr_agcpinsel_", _this->name), &_this->agcPinId, agcPinTxt)) 
             {
-                rtlsdr_set_tuner_i2c_register(_this->openDev, 0x19, 16, 16 * _this->agcPinId);
+                _this->postTunerReg(0x19, 16, 16 * _this->agcPinId);
             }
 
             SmGui::LeftLabel("Filt. Bandwith");
@@ -947,7 +1710,7 @@ private:
             {
                 int value = _this->filtBandwithManualId;
                 if (value == 2) {value = 7;} // turn 2 into b'111 (7)
-	            rtlsdr_set_tuner_i2c_register(_this->openDev, 0x0B, 224 , value << 5);
+	            _this->postTunerReg(0x0B, 224 , value << 5);
             }
             
             if (SmGui::Checkbox(CONCAT("Echo Compensation##_rtlsdr_echocomp_", _this->name), &_this->echo_compensation))
@@ -961,7 +1724,7 @@ private:
                 if(SmGui::RadioButton(CONCAT("3db##_rtlsdr_ecm_", _this->name), _this->echo_compensationId == 0))
                 {
                     _this->echo_compensationId = 0;
-                    rtlsdr_set_tuner_i2c_register(_this->openDev, 0x02, 24 , (16 * _this->echo_compensation) + (8 * _this->echo_compensationId));
+                    _this->postTunerReg(0x02, 24 , (16 * _this->echo_compensation) + (8 * _this->echo_compensationId));
                 }
 
                 SmGui::NextColumn();
@@ -970,7 +1733,7 @@ private:
                 if(SmGui::RadioButton(CONCAT("1.5db##_rtlsdr_ecm_", _this->name), _this->echo_compensationId == 1))
                 {
                     _this->echo_compensationId = 1;
-                    rtlsdr_set_tuner_i2c_register(_this->openDev, 0x02, 24 , (16 * _this->echo_compensation) + (8 * _this->echo_compensationId));
+                    _this->postTunerReg(0x02, 24 , (16 * _this->echo_compensation) + (8 * _this->echo_compensationId));
                 }
 
                 SmGui::Columns(1, CONCAT("ENDtunerecho##_te", _this->name), false);
@@ -982,28 +1745,28 @@ private:
             SmGui::FillWidth();
             if (SmGui::SliderInt(CONCAT("##rtlsdr_imagephsadj_", _this->name), &_this->imagePhaseAdjust, 0, 31))
             {
-                rtlsdr_set_tuner_i2c_register(_this->openDev, 0x09, 31 , _this->imagePhaseAdjust);
+                _this->postTunerReg(0x09, 31 , _this->imagePhaseAdjust);
             }
             
             SmGui::LeftLabel("Image Gain Adjust");
             SmGui::FillWidth();
             if (SmGui::SliderInt(CONCAT("##rtlsdr_imagegadj_", _this->name), &_this->imageGainAdjust, 0, 31))
             {
-                rtlsdr_set_tuner_i2c_register(_this->openDev, 0x08, 31 , _this->imageGainAdjust);
+                _this->postTunerReg(0x08, 31 , _this->imageGainAdjust);
             }
 
             SmGui::LeftLabel("Mixer input");
             SmGui::FillWidth();
             if (SmGui::Combo(CONCAT("##_rtlsdr_mixin_", _this->name), &_this->mixerInputSourceId, mixerInputSourceTxt)) 
             {
-                rtlsdr_set_tuner_i2c_register(_this->openDev, 0x1C, 2, 2 * _this->mixerInputSourceId);
+                _this->postTunerReg(0x1C, 2, 2 * _this->mixerInputSourceId);
             }
 
             SmGui::LeftLabel("Filt. Extension Widest");
             SmGui::FillWidth();
             if (SmGui::Checkbox(CONCAT("##_rtlsdr_filtextwidest_", _this->name), &_this->filterExtensionWidest)) 
             {
-                rtlsdr_set_tuner_i2c_register(_this->openDev, 0x0F, 128, 128 * _this->filterExtensionWidest);
+                _this->postTunerReg(0x0F, 128, 128 * _this->filterExtensionWidest);
             }
         }
         if (!_this->running) {SmGui::EndDisabled();}
@@ -1011,44 +1774,743 @@ private:
     }
 
     void worker() {
-        rtlsdr_reset_buffer(openDev);
-        rtlsdr_read_async(openDev, asyncHandler, this, 0, asyncCount);
+        // The endpoint reset is a control transfer like any other, only the bulk reads stay on this thread
+        executor.call(DEV_CMD_FLUSH, [](RTLDevice* dev) { dev->resetBuffer(); });
+        dev->readAsync(asyncHandler, this, asyncBufCount, asyncCount);
     }
 
+    // Runs on the libusb thread, only hands the buffer off so transfers get resubmitted right away
     static void asyncHandler(unsigned char* buf, uint32_t len, void* ctx) {
         RTLSDRSourceModule* _this = (RTLSDRSourceModule*)ctx;
-        int sampCount = len / 2;
-        for (int i = 0; i < sampCount; i++) {
-            _this->stream.writeBuf[i].re = ((float)buf[i * 2] - 127.4) / 128.0f;
-            _this->stream.writeBuf[i].im = ((float)buf[(i * 2) + 1] - 127.4) / 128.0f;
+        BlockStamp stamp;
+        stamp.hostTime = ClockModel::now();
+        stamp.index = _this->tracker.block(len / 2);
+        if (!_this->dev->isRealtime()) {
+            // Max speed replay waits for the converter instead of dropping, its timing means nothing
+            _this->recorder.write(buf, len, stamp);
+            while (!_this->ring.push(buf, len, stamp)) {
+                if (!_this->running) { return; }
+                std::this_thread::sleep_for(std::chrono::microseconds(100));
+            }
+            return;
+        }
+        if (_this->sampleClock.block(stamp, len / 2) && _this->recorder.isRecording()) {
+            _this->recorder.mark("sample clock discontinuity");
+        }
+        _this->recorder.write(buf, len, stamp);
+        _this->stats.block(len / 2);
+        if (!_this->ring.push(buf, len, stamp)) {
+            _this->stats.dropped(len / 2, stamp.index);
+            return;
+        }
+    }
+
+    void convWorker() {
+        int len;
+        BlockStamp stamp;
+        while (true) {
+            uint8_t* buf = ring.pop(len, &stamp);
+            if (!buf) { break; }
+
+            if (!rawTap.empty()) {
+                RTLSDRBlockTime bt { stamp.index, streamPos, stamp.hostTime, stamp.modelTime };
+                rawTap.process(buf, len, bt);
+
+                // The sinks carry the samples themselves, nothing here needs the floats
+                if (rawTap.replacesStream() && !softAgcOn && !tunerBusy()) {
+                    ring.release();
+                    continue;
+                }
+            }
+
+            int sampCount = len / 2;
+            bool correct = (dcCorrection || iqCorrection);
+            if (adcStatsOn || softAgcOn) {
+                adcStats.process(buf, (float*)stream.writeBuf, len, [this, correct](const uint8_t* in, float* out, int n) {
+                    if (correct) {
+                        corrector.process(in, out, n / 2, dcCorrection, iqCorrection);
+                    }
+                    else {
+                        convert(in, out, n);
+                    }
+                });
+            }
+            else if (correct) {
+                corrector.process(buf, (float*)stream.writeBuf, sampCount, dcCorrection, iqCorrection);
+            }
+            else {
+                convert(buf, (float*)stream.writeBuf, sampCount * 2);
+            }
+            ring.release();
+
+            if (softAgcOn) {
+                SoftAgcGains g;
+                if (softAgc.process(adcStats.getPower(), adcStats.getClipping(), sampCount, g)) { postSoftAgc(g); }
+            }
+
+            // Survey gets the full bandwidth
+            if (sweeper.isRunning()) { sweeper.feed((float*)stream.writeBuf, sampCount); }
+            if (ppmCal.isActive()) { ppmCal.feed((float*)stream.writeBuf, sampCount); }
+
+            sampCount = tracker.apply((float*)stream.writeBuf, sampCount, stamp.index, streamPos, decimation);
+            if (!sampCount) { continue; }
+
+            if (decimation) {
+                sampCount = decimator.process((float*)stream.writeBuf, sampCount);
+                if (!sampCount) { continue; }
+            }
+
+            if (!stream.swap(sampCount)) {
+                if (running) { stats.dropped(sampCount, stamp.index); }
+                break;
+            }
+            if (!streamPos) {
+                firstSampleTime = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - startTime).count();
+                flog::info("RTLSDRSourceModule '{0}': First samples {1}ms after start", name, (double)firstSampleTime);
+            }
+            sampleClock.stream(stamp, streamPos);
+            streamPos += sampCount;
+            stats.log(name);
+            sampleClock.log(name);
+        }
+    }
+
+    // Returns the sample index the new frequency takes effect at, 0 if nothing was changed
+    uint64_t retune(double freq, bool measureSettle = false) {
+        uint32_t newFreq = freq;
+        auto start = std::chrono::steady_clock::now();
+        // librtlsdr caches the frequency whenever the tuner call returns 0, which r82xx does even without
+        // a lock, so only the lock bit says the retune worked. Fast tune trusts the return code instead
+        // and skips the I2C read, and drops retunes to the frequency already set.
+        if (fastTune && dev->getCenterFreq() == newFreq) {
+            tuneSkipped++;
+            return 0;
+        }
+        int i;
+        for (i = 0; i < RETUNE_MAX_ATTEMPTS; i++) {
+            if (dev->setCenterFreq(newFreq)) { continue; }
+            if (fastTune || pllLocked(dev)) { break; }
+        }
+        uint64_t marker = tracker.mark(newFreq, measureSettle);
+        tuneHist.add(std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - start).count());
+
+        if (i >= RETUNE_MAX_ATTEMPTS) {
+            tuneFailures++;
+            tuneRetries += RETUNE_MAX_ATTEMPTS - 1;
+            flog::warn("RTL-SDR could not tune to {0}", newFreq);
+        }
+        else if (i) {
+            tuneRetries += i;
+            if (i > 1) {
+                flog::warn("RTL-SDR took {0} attempts to tune...", i);
+            }
+        }
+        return marker;
+    }
+
+    // Executor thread, tuners without a lock indicator count as locked
+    bool pllLocked(RTLDevice* dev) {
+        rtlsdr_tuner tuner = dev->getTunerType();
+        if (tuner != RTLSDR_TUNER_R820T && tuner != RTLSDR_TUNER_R828D) { return true; }
+        unsigned char regs[128] = { 0 };
+        int len = R82XX_LOCK_REG + 1;
+        int strength = 0;
+        if (dev->getTunerI2cRegister(regs, &len, &strength)) { return true; }
+        return (regs[R82XX_LOCK_REG] & R82XX_LOCK_BIT) != 0;
+    }
+
+    // What start() programs into the device
+    DeviceSetup getSetup() {
+        DeviceSetup ds;
+        ds.sampleRate = sampleRate;
+        ds.freq = freq;
+        ds.ppm = ppm;
+        ds.directSampling = directSamplingMode;
+        ds.biasT = biasT;
+        ds.rtlAgc = rtlAgc;
+        ds.gainMode = 1;
+        ds.gain = getGain();
+        ds.offsetTuning = offsetTuning;
+        return ds;
+    }
+
+    // Executor thread. Without have every setting is written, otherwise only what differs from it.
+    void applySetup(RTLDevice* dev, const DeviceSetup& want, const DeviceSetup* have) {
+        int n = 0;
+        if (!have || have->sampleRate != want.sampleRate) { dev->setSampleRate(want.sampleRate); n++; }
+        if (!have || have->freq != want.freq) { dev->setCenterFreq(want.freq); n++; }
+        if (!have || have->ppm != want.ppm) { dev->setFreqCorrection(want.ppm); n++; }
+        if (!have) { dev->setTunerBandwidth(0); n++; }
+        if (!have || have->directSampling != want.directSampling) { dev->setDirectSampling(want.directSampling); n++; }
+        if (!have || have->biasT != want.biasT) { dev->setBiasTee(want.biasT); n++; }
+        if (!have || have->rtlAgc != want.rtlAgc) { dev->setAgcMode(want.rtlAgc); n++; }
+        if (!have) { dev->setTunerGain(want.gain); n++; }
+
+        if (!have || have->gainMode != want.gainMode || have->gain != want.gain) {
+            dev->setTunerGainMode(want.gainMode); //manual mode default
+            dev->setTunerGain(want.gain);
+            n += 2;
+        }
+
+        if (!have || have->offsetTuning != want.offsetTuning) { dev->setOffsetTuning(want.offsetTuning); n++; }
+        flog::info("RTLSDRSourceModule '{0}': {1} setup calls", name, n);
+    }
+
+    static void readCaps(RTLDevice* dev, DeviceCaps& caps) {
+        int gains[256];
+        int n = dev->getTunerGains(gains);
+        caps.tuner = dev->getTunerType();
+        caps.gains = std::vector<int>(gains, gains + std::max<int>(n, 0));
+        std::sort(caps.gains.begin(), caps.gains.end());
+    }
+
+    // The open device disagrees with the cache
+    void updateCaps(const DeviceCaps& caps) {
+        flog::warn("RTLSDRSourceModule '{0}': Cached capabilities of '{1}' were stale", name, selectedDevName);
+        deviceCache.putCaps(devCapsKeys[devId], caps);
+        saveDeviceCache();
+        gainList = caps.gains;
+        capsTuner = caps.tuner;
+        clampGainId();
+        updateGainTxt();
+    }
+
+    // An empty gain table (tuner that couldn't be read) leaves gainId at 0 and getGain() at 0
+    void clampGainId() {
+        gainId = std::clamp<int>(gainId, 0, std::max<int>((int)gainList.size() - 1, 0));
+    }
+
+    int getGain() {
+        return gainList.empty() ? 0 : gainList[gainId];
+    }
+
+    void saveDeviceCache() {
+        if (!deviceCache.isDirty()) { return; }
+        config.acquire();
+        config.conf["deviceCache"] = deviceCache.save();
+        config.release(true);
+    }
+
+    // USB event thread, the list is rebuilt by the menu once nothing is running
+    static void devicesChanged(const std::string& location, void* ctx) {
+        RTLSDRSourceModule* _this = (RTLSDRSourceModule*)ctx;
+
+        // Whatever is in that port now (if anything) gets its strings read again
+        deviceCache.dropStrings(location);
+        _this->devicesPending = true;
+    }
+
+    // Executor thread, the port's cached strings can predate a dongle swapped while SDR++ wasn't running
+    void verifyStrings(RTLDevice* dev) {
+        char manBuf[256];
+        char prodBuf[256];
+        char snBuf[256];
+        if (devLocations[devId].empty() || dev->getUsbStrings(manBuf, prodBuf, snBuf)) { return; }
+        if (devSerials[devId] == snBuf) { return; }
+        flog::warn("RTLSDRSourceModule '{0}': '{1}' is actually serial '{2}', the device list is rebuilt once stopped", name, selectedDevName, snBuf);
+        deviceCache.dropStrings(devLocations[devId]);
+        devicesPending = true;
+    }
+
+    // Closes the device kept open by a warm standby stop
+    void closeStandby() {
+        if (!standby) { return; }
+        standby = false;
+        executor.close();
+        dev = NULL;
+    }
+
+    // Retune from a thread that needs the marker, waits for the executor
+    uint64_t retuneNow(double freq, bool measureSettle = false) {
+        uint64_t marker = 0;
+        executor.call(DEV_CMD_TUNE, [this, freq, measureSettle, &marker](RTLDevice* dev) { marker = retune(freq, measureSettle); });
+        return marker;
+    }
+
+    // Gain mode and the R820T LNA/mixer auto bits for the current control mode, as one command
+    void postControlMode() {
+        int mode = controlMode;
+        int gain = getGain();
+        int gainMode = (mode != 2) ? 1 : ((agcModeId == 0) ? 0 : 2);
+        uint8_t lna = lnaGain;
+        uint8_t mixer = mixerGain;
+        int vga = vgaGain;
+
+        // The module AGC runs the tuner in manual mode and starts from where it left the ladder
+        softAgcOn = (mode == 2 && agcModeId == 2);
+        if (softAgcOn) {
+            SoftAgcGains g = SoftAgc::stepGains(softAgc.getStep());
+            mode = 1;
+            lna = g.lna;
+            mixer = g.mixer;
+            vga = g.vga;
+        }
+        executor.post(DEV_CMD_GAIN_MODE, [mode, gain, gainMode, lna, mixer, vga](RTLDevice* dev) {
+            if (mode == 2) {
+                dev->setTunerGain(gain); // bug fix
+                dev->queueTunerI2cRegister(0x05, 0x10, 0x00); // lna auto gain
+                dev->queueTunerI2cRegister(0x07, 0x10, 0x10); // mixer auto gain
+                dev->setTunerGainMode(gainMode); // 0 hardware, 2 software
+                return;
+            }
+
+            dev->setTunerGainMode(1); // manual mod
+            dev->setTunerGain(gain); // bug fix
+            if (mode == 0) {
+                dev->queueTunerI2cRegister(0x05, 0x10, 0x00); // lna auto gain
+                dev->queueTunerI2cRegister(0x07, 0x10, 0x10); // mixer auto gain
+                return;
+            }
+            dev->queueTunerI2cRegister(0x05, 0x10, 0x10); // lna manual gain
+            dev->queueTunerI2cRegister(0x07, 0x10, 0x00); // mixer manual gain
+            dev->queueTunerI2cRegister(0x05, 0x0F, lna);
+            dev->queueTunerI2cRegister(0x07, 0x0F, mixer);
+            dev->setTunerGainIndex(vga);
+        });
+    }
+
+    // Converter thread, only the latest step is still worth sending if the executor is behind
+    void postSoftAgc(const SoftAgcGains& g) {
+        executor.post(DEV_CMD_SOFT_AGC, [g](RTLDevice* dev) {
+            dev->queueTunerI2cRegister(0x05, 0x0F, g.lna);
+            dev->queueTunerI2cRegister(0x07, 0x0F, g.mixer);
+            dev->setTunerGainIndex(g.vga);
+        });
+    }
+
+    void saveSoftAgcConfig() {
+        softAgc.setTarget(softAgcTarget);
+        softAgc.setAttack(softAgcAttack);
+        softAgc.setDecay(softAgcDecay);
+        softAgc.setHysteresis(softAgcHysteresis);
+        config.acquire();
+        config.conf["instances"][name]["softAgc"]["target"] = softAgcTarget;
+        config.conf["instances"][name]["softAgc"]["attack"] = softAgcAttack;
+        config.conf["instances"][name]["softAgc"]["decay"] = softAgcDecay;
+        config.conf["instances"][name]["softAgc"]["hysteresis"] = softAgcHysteresis;
+        config.release(true);
+    }
+
+    // Later writes to the same bits of a register replace queued ones
+    void postTunerReg(int reg, uint8_t mask, uint8_t data) {
+        executor.post(DEV_CMD_TUNER_REG, [reg, mask, data](RTLDevice* dev) { dev->queueTunerI2cRegister(reg, mask, data); }, (reg << 8) | mask);
+    }
+
+    void postIfFreq() {
+        int ifFreq = if_freq_tuner;
+        executor.post(DEV_CMD_IF_FREQ, [ifFreq](RTLDevice* dev) { dev->setIfFreq(ifFreq); });
+    }
+
+    // Retunes back and forth around center and times how long the power takes to settle after every
+    // retune, the worst case becomes the device's settle time once the UI thread picks it up
+    void measureSettleTime(double center) {
+        double worst = 0.0;
+        int measured = 0;
+        for (int i = 0; i < SETTLE_MEASURE_COUNT && running; i++) {
+            retuneNow(center + ((i & 1) ? 0.0 : SETTLE_MEASURE_STEP), true);
+            auto start = std::chrono::steady_clock::now();
+            double settle;
+            bool done = false;
+            while (running && !(done = tracker.getMeasurement(settle))) {
+                if (std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count() > SETTLE_MEASURE_TIMEOUT) { break; }
+                std::this_thread::sleep_for(std::chrono::milliseconds(5));
+            }
+            if (!done) { continue; }
+            worst = std::max<double>(worst, settle);
+            measured++;
+        }
+        if (running) { retuneNow(center); }
+
+        if (measured) {
+            measuredSettle = worst;
+            measuredSettleSet = true;
+        }
+        measuringSettle = false;
+    }
+
+    void takeSettleTime() {
+        if (!measuredSettleSet.exchange(false)) { return; }
+        settleTime = measuredSettle;
+        tracker.setSettle(settleTime);
+        flog::info("RTLSDRSourceModule '{0}': Settle time of '{1}' is {2}ms", name, selectedDevName, settleTime * 1000.0);
+        if (selectedDevName != "") {
+            config.acquire();
+            config.conf["devices"][selectedDevName]["settleTime"] = settleTime;
+            config.release(true);
+        }
+    }
+
+    RTLSDRTuneStats getTuneStats() {
+        RTLSDRTuneStats st;
+        st.count = tuneHist.getCount();
+        st.p50 = tuneHist.percentile(0.5);
+        st.p99 = tuneHist.percentile(0.99);
+        st.max = tuneHist.getMax();
+        st.retries = tuneRetries;
+        st.failures = tuneFailures;
+        st.skipped = tuneSkipped;
+        return st;
+    }
+
+    void clearTuneStats() {
+        tuneHist.clear();
+        tuneRetries = 0;
+        tuneFailures = 0;
+        tuneSkipped = 0;
+    }
+
+    // Pins the USB and conversion threads to their CPUs and sets their scheduling. The converter runs one
+    // step below the USB thread so a callback is never kept waiting on it. Failures leave the threads as they were.
+    void applyThreadSettings() {
+        if (!usbCpus.empty() && !affinity::apply(workerThread, usbCpus)) {
+            flog::warn("RTLSDRSourceModule '{0}': Could not pin the USB thread to '{1}'", name, usbCpusTxt);
+        }
+        if (!convCpus.empty() && !affinity::apply(convThread, convCpus)) {
+            flog::warn("RTLSDRSourceModule '{0}': Could not pin the converter thread to '{1}'", name, convCpusTxt);
+        }
+
+        bool ok = affinity::setPriority(workerThread, schedPolicy, schedPriority);
+        ok &= affinity::setPriority(convThread, schedPolicy, std::max<int>(1, schedPriority - 1));
+        if (!ok && !schedWarned) {
+            flog::warn("RTLSDRSourceModule '{0}': Real time scheduling refused, running at normal priority (needs CAP_SYS_NICE or an rtprio limit)", name);
+            schedWarned = true;
+        }
+        if (ok) { schedWarned = false; }
+    }
+
+    void setCpus(const std::string& str, char* txt, size_t len, std::vector<int>& cpus) {
+        strncpy(txt, str.c_str(), len - 1);
+        txt[len - 1] = 0;
+        if (!affinity::parse(txt, cpus)) { cpus.clear(); }
+    }
+
+    void saveSchedConfig() {
+        if (selectedDevName == "") { return; }
+        config.acquire();
+        config.conf["devices"][selectedDevName]["usbCpus"] = std::string(usbCpusTxt);
+        config.conf["devices"][selectedDevName]["convCpus"] = std::string(convCpusTxt);
+        config.conf["devices"][selectedDevName]["schedPolicy"] = schedPolicy;
+        config.conf["devices"][selectedDevName]["schedPriority"] = schedPriority;
+        config.release(true);
+    }
+
+    // Rate seen by the rest of SDR++ once the decimation chain is applied
+    double getOutputRate() {
+        return sampleRate / (double)(1 << decimation);
+    }
+
+    // Turns the buffer profile into a librtlsdr transfer count/size for the current sample rate
+    void updateBufferParams() {
+        if (bufferProfile == BUFFER_PROFILE_CUSTOM) {
+            customBufferCount = std::clamp<int>(customBufferCount, 2, RTL_MAX_BUFFER_COUNT);
+            customTransferSize = std::clamp<int>(customTransferSize, RTL_TRANSFER_ALIGN, RTL_MAX_TRANSFER_SIZE);
+            customTransferSize -= customTransferSize % RTL_TRANSFER_ALIGN;
+            asyncBufCount = customBufferCount;
+            asyncCount = customTransferSize;
+        }
+        else {
+            asyncBufCount = bufferProfileCount[bufferProfile];
+            asyncCount = bufferProfileTransferSize(bufferProfile, sampleRate);
+        }
+
+        // Give the converter ring at least 200ms of slack no matter how small the blocks are
+        double blockTime = (double)asyncCount / (sampleRate * 2.0);
+        ringSlots = std::max<int>(std::max<int>(32, asyncBufCount * 2), (int)ceil(0.2 / blockTime));
+
+        sprintf(bufferInfoTxt, "%d x %.1fKB (%.2fms)", asyncBufCount, (double)asyncCount / 1024.0, blockTime * 1000.0);
+    }
+
+    void saveReplayConfig() {
+        if (selectedDevName == "") { return; }
+        config.acquire();
+        config.conf["devices"][selectedDevName]["replayPacing"] = replayPacing;
+        config.conf["devices"][selectedDevName]["replayLoop"] = replayLoop;
+        config.release(true);
+    }
+
+    void saveBufferConfig() {
+        if (selectedDevName == "") { return; }
+        config.acquire();
+        config.conf["devices"][selectedDevName]["bufferProfile"] = bufferProfile;
+        config.conf["devices"][selectedDevName]["bufferCount"] = customBufferCount;
+        config.conf["devices"][selectedDevName]["transferSize"] = customTransferSize;
+        config.release(true);
+    }
+
+    void startSweep() {
+        SweepParams params;
+        if (!Sweeper::parseRanges(sweepRangesTxt, params.ranges)) {
+            flog::error("Invalid sweep ranges '{0}'", sweepRangesTxt);
+            return;
+        }
+        params.sampleRate = sampleRate;
+        params.fftSize = 256 << sweepFftSizeId;
+        params.dwell = (double)sweepDwell / 1000.0;
+        params.settle = (double)sweepSettle / 1000.0;
+        params.format = sweepFormat;
+        params.loop = sweepLoop;
+
+        std::string folder = rawRecPath;
+        std::error_code ec;
+        std::filesystem::create_directories(folder, ec);
+        char tbuf[64];
+        time_t now = time(NULL);
+        strftime(tbuf, sizeof(tbuf), "%Y%m%d-%H%M%S", localtime(&now));
+        std::string path = folder + "/sweep_" + tbuf + ((sweepFormat == SWEEP_FORMAT_CSV) ? ".csv" : ".bin");
+
+        sweeper.start(params, path, ownedTune, releaseTuner, this);
+    }
+
+    // The sweep, the settle measurement and the ppm calibration take the tuner away from the user
+    bool tunerBusy() {
+        return sweeper.isRunning() || measuringSettle || ppmCal.isActive();
+    }
+
+    // Retune on behalf of whoever owns the tuner
+    static uint64_t ownedTune(double freq, void* ctx) {
+        RTLSDRSourceModule* _this = (RTLSDRSourceModule*)ctx;
+        uint64_t marker = _this->retuneNow(freq);
+        if (_this->recorder.isRecording()) { _this->recorder.retune(freq); }
+
+        // Everything between what the converter already went through and the marker is still the old frequency
+        uint64_t converted = _this->tracker.getConverted();
+        return (marker > converted) ? marker - converted : 0;
+    }
+
+    // Back to where the user wanted to be, runs on the thread that owned the tuner
+    static void releaseTuner(void* ctx) {
+        RTLSDRSourceModule* _this = (RTLSDRSourceModule*)ctx;
+        if (!_this->running) { return; }
+        double freq = _this->releaseFreq;
+        _this->executor.post(DEV_CMD_TUNE, [_this, freq](RTLDevice* dev) { _this->retune(freq); });
+        if (_this->recorder.isRecording()) { _this->recorder.retune(freq); }
+    }
+
+    void startPpmCalibration(double refFreq) {
+        if (!running || tunerBusy() || refFreq <= 0.0) { return; }
+        PpmCalParams params;
+        params.refFreq = refFreq;
+        params.sampleRate = sampleRate;
+        params.ppm = ppm;
+        params.dwell = (double)ppmCalDwell / 1000.0;
+        params.settle = settleTime;
+        params.interval = (double)ppmCalInterval * 60.0;
+        ppmCal.start(params, ownedTune, ppmCalApply, releaseTuner, this);
+    }
+
+    // Calibration thread, ppm itself belongs to the UI thread and is picked up by takeCalibratedPpm()
+    static void ppmCalApply(int ppm, void* ctx) {
+        RTLSDRSourceModule* _this = (RTLSDRSourceModule*)ctx;
+        _this->executor.call(DEV_CMD_PPM, [ppm](RTLDevice* dev) { dev->setFreqCorrection(ppm); });
+        _this->calibratedPpm = ppm;
+        _this->calibratedPpmSet = true;
+        if (_this->recorder.isRecording()) {
+            _this->recorder.annotate("ppm " + std::to_string(ppm) + " (calibrated)");
+        }
+    }
+
+    void takeCalibratedPpm() {
+        if (!calibratedPpmSet.exchange(false)) { return; }
+        ppm = calibratedPpm;
+        if (selectedDevName != "") {
+            config.acquire();
+            config.conf["devices"][selectedDevName]["ppm"] = ppm;
+            config.release(true);
+        }
+    }
+
+    void saveSweepConfig() {
+        config.acquire();
+        config.conf["instances"][name]["sweep"]["ranges"] = std::string(sweepRangesTxt);
+        config.conf["instances"][name]["sweep"]["fftSize"] = sweepFftSizeId;
+        config.conf["instances"][name]["sweep"]["dwell"] = sweepDwell;
+        config.conf["instances"][name]["sweep"]["settle"] = sweepSettle;
+        config.conf["instances"][name]["sweep"]["format"] = sweepFormat;
+        config.conf["instances"][name]["sweep"]["loop"] = sweepLoop;
+        config.release(true);
+    }
+
+    void startRawRecording() {
+        std::string folder = rawRecPath;
+        std::error_code ec;
+        std::filesystem::create_directories(folder, ec);
+
+        char tbuf[64];
+        time_t now = time(NULL);
+        strftime(tbuf, sizeof(tbuf), "%Y%m%d-%H%M%S", localtime(&now));
+        char fname[256];
+        sprintf(fname, "/rtlsdr_%.0lfHz_%.0lfsps_%s", freq, sampleRate, tbuf);
+
+        json info = json({});
+        info["core:hw"] = selectedDevName;
+        info["rtlsdr:gain_mode"] = controlMode;
+        info["rtlsdr:gain"] = (double)getGain() / 10.0;
+        info["rtlsdr:lna_gain"] = lnaGain;
+        info["rtlsdr:mixer_gain"] = mixerGain;
+        info["rtlsdr:vga_gain"] = vgaGain;
+        info["rtlsdr:agc_mode"] = agcModeId;
+        info["rtlsdr:rtl_agc"] = rtlAgc;
+        info["rtlsdr:ppm"] = ppm;
+        info["rtlsdr:bias_t"] = biasT;
+        info["rtlsdr:offset_tuning"] = offsetTuning;
+        recorder.start(folder + fname, sampleRate, freq, info, asyncCount);
+    }
+
+    RTLSDRBufferStats getBufferStats() {
+        RTLSDRBufferStats bs;
+        bs.poolBytes = pool.getSize();
+        bs.usedBytes = pool.getUsed();
+        bs.highWater = pool.getHighWater();
+        bs.hugePages = pool.isHuge();
+        bs.locked = pool.isLocked();
+        bs.ringSlots = ring.capacity();
+        bs.ringOccupancy = ring.occupancy();
+        bs.ringHighWater = ring.getHighWater();
+        return bs;
+    }
+
+    // Leaves the clock model in the metadata, the timestamps file has the per block times
+    void stopRawRecording() {
+        if (!recorder.isRecording()) { return; }
+        RTLSDRClockState cs = sampleClock.get();
+        json clk = json({});
+        clk["nominal_rate"] = cs.nominalRate;
+        clk["rate"] = cs.rate;
+        clk["ppm"] = cs.ppm;
+        clk["jitter_us"] = cs.jitter;
+        clk["anchor_sample"] = cs.anchorIndex;
+        clk["anchor_ns"] = cs.anchorTime;
+        clk["wall_offset_ns"] = cs.wallOffset;
+        clk["discontinuities"] = cs.discontinuities;
+        recorder.setGlobal("rtlsdr:clock", clk);
+        recorder.stop();
+    }
+
+    // Logs the current gain setup into the recording metadata
+    void annotateGains() {
+        if (!recorder.isRecording()) { return; }
+        char buf[256];
+        if (controlMode == 0) {
+            sprintf(buf, "gain %.1f dB", (float)getGain() / 10.0f);
+        }
+        else if (controlMode == 1) {
+            sprintf(buf, "manual gain lna %d mixer %d vga %d", lnaGain, mixerGain, vgaGain);
+        }
+        else {
+            const char* agcNames[] = { "hardware", "software", "module" };
+            sprintf(buf, "%s agc", agcNames[std::clamp<int>(agcModeId, 0, 2)]);
+        }
+        recorder.annotate(buf);
+    }
+
+    static void moduleInterfaceHandler(int code, void* in, void* out, void* ctx) {
+        RTLSDRSourceModule* _this = (RTLSDRSourceModule*)ctx;
+        if (code == RTLSDR_IFACE_CMD_GET_STREAM_STATS && out) {
+            *(RTLSDRStreamStats*)out = _this->stats.get();
+        }
+        else if (code == RTLSDR_IFACE_CMD_GET_GAPS && out) {
+            *(std::vector<RTLSDRGapEvent>*)out = _this->stats.getGaps();
+        }
+        else if (code == RTLSDR_IFACE_CMD_RESET_STREAM_STATS) {
+            _this->stats.clear();
+        }
+        else if (code == RTLSDR_IFACE_CMD_GET_TELEMETRY && out) {
+            *(RTLSDRTelemetry*)out = _this->telemetry.get();
+        }
+        else if (code == RTLSDR_IFACE_CMD_GET_TUNE_STATS && out) {
+            *(RTLSDRTuneStats*)out = _this->getTuneStats();
+        }
+        else if (code == RTLSDR_IFACE_CMD_RESET_TUNE_STATS) {
+            _this->clearTuneStats();
+        }
+        else if (code == RTLSDR_IFACE_CMD_GET_RETUNES && out) {
+            *(std::vector<RTLSDRRetuneMarker>*)out = _this->tracker.getMarkers();
+        }
+        else if (code == RTLSDR_IFACE_CMD_GET_STREAM_POSITION && out) {
+            *(uint64_t*)out = _this->streamPos;
+        }
+        else if (code == RTLSDR_IFACE_CMD_GET_COMMAND_STATS && out) {
+            *(RTLSDRCommandStats*)out = _this->executor.getTotalStats();
+        }
+        else if (code == RTLSDR_IFACE_CMD_GET_ADC_STATS && out) {
+            *(RTLSDRAdcStats*)out = _this->adcStats.get();
+        }
+        else if (code == RTLSDR_IFACE_CMD_GET_CLOCK && out) {
+            *(RTLSDRClockState*)out = _this->sampleClock.get();
+        }
+        else if (code == RTLSDR_IFACE_CMD_GET_BLOCK_TIMES && out) {
+            *(std::vector<RTLSDRBlockTime>*)out = _this->sampleClock.getBlocks();
+        }
+        else if (code == RTLSDR_IFACE_CMD_GET_PPM_CALIBRATION && out) {
+            *(RTLSDRPpmCalibration*)out = _this->ppmCal.get();
+        }
+        else if (code == RTLSDR_IFACE_CMD_START_PPM_CALIBRATION) {
+            _this->startPpmCalibration(in ? *(double*)in : _this->ppmCalRef);
+        }
+        else if (code == RTLSDR_IFACE_CMD_ADD_RAW_SINK && in) {
+            _this->rawTap.add(*(RTLSDRRawSink*)in);
+        }
+        else if (code == RTLSDR_IFACE_CMD_REMOVE_RAW_SINK && in) {
+            _this->rawTap.remove(*(RTLSDRRawSink*)in);
+        }
+        else if (code == RTLSDR_IFACE_CMD_GET_BUFFER_STATS && out) {
+            *(RTLSDRBufferStats*)out = _this->getBufferStats();
+        }
+        else if (code == RTLSDR_IFACE_CMD_GET_JITTER && out) {
+            *(RTLSDRJitterStats*)out = _this->stats.getJitter();
+        }
+        else if (code == RTLSDR_IFACE_CMD_GET_START_LATENCY && out) {
+            *(double*)out = _this->firstSampleTime;
         }
-        if (!_this->stream.swap(sampCount)) { return; }
     }
 
     void updateGainTxt() {
-        sprintf(dbTxt, "%.1f dB", (float)gainList[gainId] / 10.0f);
+        sprintf(dbTxt, "%.1f dB", (float)getGain() / 10.0f);
     }
 
     std::string name;
-    rtlsdr_dev_t* openDev;
+    std::string sourceName;
+    RTLDevice* dev = NULL;
     bool enabled = true;
     dsp::stream<dsp::complex_t> stream;
     double sampleRate;
     SourceManager::SourceHandler handler;
-    bool running = false;
+    std::atomic<bool> running = false;
     double freq;
+    std::atomic<double> releaseFreq = 0.0;   // Copy of freq for the threads that borrow the tuner
     std::string selectedDevName = "";
     int devId = 0;
     int srId = 0;
     int devCount = 0;
+    int realDevCount = 0;
+    bool isReplay = false;
+    std::vector<std::string> replayFiles;
+    int replayPacing = REPLAY_PACING_REALTIME;
+    bool replayLoop = true;
     std::thread workerThread;
+    std::thread convThread;
+    std::string legacyCpus;
+    char usbCpusTxt[64] = "";
+    char convCpusTxt[64] = "";
+    std::vector<int> usbCpus;
+    std::vector<int> convCpus;
+    int schedPolicy = affinity::POLICY_NORMAL;
+    int schedPriority = SCHED_DEFAULT_PRIORITY;
+    bool schedWarned = false;
     bool serverMode = false;
+    RawTap rawTap;
+
+    BufferPool pool;
+    bool hugePages = false;
+    bool lockBuffers = false;
 
 #ifdef __ANDROID__
     int devFd = -1;
 #endif
 
     int ppm = 0;
+    std::atomic<int> calibratedPpm = 0;
+    std::atomic<bool> calibratedPpmSet = false;
 
     bool biasT = false;
 
@@ -1072,11 +2534,70 @@ private:
     int lnaGain = 0;
     int mixerGain = 0;
 
-    int len = 4;
+    bool fastTune = false;
+    LatencyHistogram tuneHist;
+    std::atomic<uint64_t> tuneRetries = 0;
+    std::atomic<uint64_t> tuneFailures = 0;
+    std::atomic<uint64_t> tuneSkipped = 0;
+
+    DeviceExecutor executor;
+    UsbWatcher usbWatcher;
+
+    SoftAgc softAgc;
+    AdcStats adcStats;
+    ClockModel sampleClock;
+    bool adcStatsOn = true;
+    std::atomic<bool> softAgcOn = false;
+    float softAgcTarget = SOFT_AGC_DEFAULT_TARGET;
+    float softAgcAttack = SOFT_AGC_DEFAULT_ATTACK;
+    float softAgcDecay = SOFT_AGC_DEFAULT_DECAY;
+    float softAgcHysteresis = SOFT_AGC_DEFAULT_HYSTERESIS;
+    std::atomic<bool> devicesPending = false;
+    std::vector<std::string> devCapsKeys;
+    std::vector<std::string> devLocations;     // Empty when libusb couldn't tell the port
+    std::vector<std::string> devSerials;
+    int capsTuner = RTLSDR_TUNER_UNKNOWN;
+
+    bool warmStandby = false;
+    bool standby = false;
+    bool warmStart = false;
+    DeviceSetup applied = {};   // What the device was left at when it went into standby
+    std::chrono::steady_clock::time_point startTime;
+    std::atomic<double> firstSampleTime = -1.0;
+
+    RetuneTracker tracker;
+    std::atomic<uint64_t> streamPos = 0;
+    int settleMode = SETTLE_MODE_OFF;
+    double settleTime = RETUNE_DEFAULT_SETTLE;
+    std::atomic<bool> measuringSettle = false;
+    std::atomic<double> measuredSettle = 0.0;
+    std::atomic<bool> measuredSettleSet = false;
+    std::thread settleThread;
+
+    Sweeper sweeper;
+    char sweepRangesTxt[256] = "88M-108M";
+    int sweepFftSizeId = 2;
+    int sweepDwell = 100;
+    int sweepSettle = 10;
+    int sweepFormat = SWEEP_FORMAT_CSV;
+    bool sweepLoop = true;
+
+    PpmCalibrator ppmCal;
+    double ppmCalRef = 0.0;
+    int ppmCalDwell = 500;
+    int ppmCalInterval = 0;
+
+    TelemetrySampler telemetry;
+    int telemetryRate = TELEMETRY_DEFAULT_RATE;
     float strength = 0;
-    unsigned char tuner_register_read[128];
     
     bool offsetTuning = false;
+
+    IQCorrector corrector;
+    bool dcCorrection = false;
+    bool iqCorrection = false;
+    Decimator decimator;
+    int decimation = 0;
     int agcClockId = 1;
 
     /*
@@ -1153,6 +2674,18 @@ private:
 
     // Handler stuff
     int asyncCount = 0;
+    int asyncBufCount = 0;
+    int bufferProfile = BUFFER_PROFILE_BALANCED;
+    int customBufferCount = 15;
+    int customTransferSize = 16 * 32 * 512;
+    char bufferInfoTxt[128];
+    cu8::Kernel convKernel = cu8::KERNEL_SCALAR;
+    cu8::convert_t convert = nullptr;
+    SPSCRing ring;
+    StreamStats stats;
+    RawRecorder recorder;
+    char rawRecPath[1024];
+    int ringSlots = 32;
 
     char dbTxt[128];
     char vgaGainTxt[20];
@@ -1174,6 +2707,7 @@ MOD_EXPORT void _INIT_() {
     json def = json({});
     def["devices"] = json({});
     def["device"] = 0;
+    def["instances"] = json({});
     config.setPath(core::args["root"].s() + "/rtl_sdr_config.json");
     config.load(def);
     config.enableAutoSave();
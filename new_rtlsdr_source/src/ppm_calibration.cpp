@@ -0,0 +1,206 @@
+#include "ppm_calibration.h"
+#include <math.h>
+#include <string.h>
+#include <chrono>
+#include <algorithm>
+#include <utils/flog.h>
+#include "fft.h"
+
+// The reference is put this far (fraction of the sample rate) above the center, clear of the DC spike
+#define PPM_CAL_OFFSET          0.125
+
+// A measurement within this of the applied correction doesn't change it, rtlsdr only takes whole ppm
+#define PPM_CAL_TOLERANCE       0.6
+
+PpmCalibrator::~PpmCalibrator() {
+    stop();
+}
+
+bool PpmCalibrator::start(const PpmCalParams& params, tune_t tune, apply_t apply, done_t done, void* ctx) {
+    stop();
+    if (params.refFreq <= 0.0 || params.sampleRate <= 0.0) { return false; }
+
+    this->params = params;
+    userPpmSet = false;
+    this->tune = tune;
+    this->apply = apply;
+    this->done = done;
+    this->ctx = ctx;
+    offset = params.sampleRate * PPM_CAL_OFFSET;
+
+    // Everything the worker needs is allocated here
+    int n = PPM_CAL_FFT_SIZE;
+    int averages = std::max<int>(1, (int)round(params.dwell * params.sampleRate / (double)n));
+    captureSize = averages * n;
+    captureBuf.resize((size_t)captureSize * 2);
+    work.resize((size_t)n * 2);
+    power.resize(n);
+    fft::hann(window, n);
+    fft::twiddles(twiddle, n);
+
+    {
+        std::lock_guard<std::mutex> lck(resultMtx);
+        result.refFreq = params.refFreq;
+    }
+
+    state = PPM_CAL_STATE_IDLE;
+    running = true;
+    workerThread = std::thread(&PpmCalibrator::worker, this);
+    flog::info("PPM calibration started on {0} Hz", params.refFreq);
+    return true;
+}
+
+void PpmCalibrator::stop() {
+    {
+        std::lock_guard<std::mutex> lck(mtx);
+        running = false;
+    }
+    cnd.notify_all();
+    if (workerThread.joinable()) { workerThread.join(); }
+}
+
+void PpmCalibrator::setPpm(int ppm) {
+    userPpm = ppm;
+    userPpmSet = true;
+}
+
+void PpmCalibrator::feed(const float* data, int count) {
+    if (state.load(std::memory_order_acquire) != PPM_CAL_STATE_CAPTURE) { return; }
+
+    if (discard) {
+        int n = (int)std::min<uint64_t>(discard, count);
+        discard -= n;
+        data += n * 2;
+        count -= n;
+    }
+
+    int n = std::min<int>(count, captureSize - captured);
+    if (n <= 0) { return; }
+    memcpy(&captureBuf[(size_t)captured * 2], data, (size_t)n * 2 * sizeof(float));
+    captured += n;
+
+    if (captured == captureSize) {
+        std::lock_guard<std::mutex> lck(mtx);
+        state.store(PPM_CAL_STATE_DONE, std::memory_order_release);
+        cnd.notify_all();
+    }
+}
+
+RTLSDRPpmCalibration PpmCalibrator::get() {
+    std::lock_guard<std::mutex> lck(resultMtx);
+    RTLSDRPpmCalibration r = result;
+    r.active = active;
+    r.scheduled = running && !active && params.interval > 0.0;
+    return r;
+}
+
+void PpmCalibrator::worker() {
+    while (running) {
+        active = true;
+        bool ok = run();
+        active = false;
+        {
+            std::lock_guard<std::mutex> lck(resultMtx);
+            result.ok = ok;
+            result.runs++;
+            result.time = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::system_clock::now().time_since_epoch()).count();
+        }
+        if (done) { done(ctx); }
+        if (params.interval <= 0.0) { break; }
+
+        std::unique_lock<std::mutex> lck(mtx);
+        cnd.wait_for(lck, std::chrono::duration<double>(params.interval), [this]() { return !running; });
+    }
+    running = false;
+}
+
+bool PpmCalibrator::run() {
+    if (userPpmSet.exchange(false)) { params.ppm = userPpm; }
+    for (int i = 0; i < PPM_CAL_MAX_ITERATIONS; i++) {
+        if (!capture(params.refFreq - offset)) { return false; }
+
+        double freq, snr;
+        bool found = estimate(freq, snr);
+        double error = (offset - freq) / params.refFreq * 1e6;
+        {
+            std::lock_guard<std::mutex> lck(resultMtx);
+            result.snr = snr;
+            result.error = found ? error : 0.0;
+            result.ppm = params.ppm;
+        }
+        if (!found) {
+            flog::warn("PPM calibration: no carrier near {0} Hz ({1} dB SNR)", params.refFreq, snr);
+            return false;
+        }
+
+        // A higher LO than asked for moves the carrier down, the correction has to go up by as much
+        if (fabs(error) < PPM_CAL_TOLERANCE) {
+            flog::info("PPM calibration: {0} ppm (residual {1} ppm, {2} dB SNR)", params.ppm, error, snr);
+            return true;
+        }
+        params.ppm = (int)round((double)params.ppm + error);
+        apply(params.ppm, ctx);
+    }
+    flog::warn("PPM calibration: didn't settle after {0} corrections, left at {1} ppm", PPM_CAL_MAX_ITERATIONS, params.ppm);
+    return false;
+}
+
+bool PpmCalibrator::capture(double freq) {
+    uint64_t inFlight = tune(freq, ctx);
+
+    std::unique_lock<std::mutex> lck(mtx);
+    discard = (uint64_t)(params.settle * params.sampleRate) + inFlight;
+    captured = 0;
+    state.store(PPM_CAL_STATE_CAPTURE, std::memory_order_release);
+    cnd.wait(lck, [this]() { return state == PPM_CAL_STATE_DONE || !running; });
+    state = PPM_CAL_STATE_IDLE;
+    return running;
+}
+
+bool PpmCalibrator::estimate(double& freq, double& snr) {
+    int n = PPM_CAL_FFT_SIZE;
+    std::fill(power.begin(), power.end(), 0.0);
+    for (int seg = 0; seg < captureSize / n; seg++) {
+        const float* in = &captureBuf[(size_t)seg * n * 2];
+        for (int i = 0; i < n; i++) {
+            work[2 * i] = in[2 * i] * window[i];
+            work[2 * i + 1] = in[2 * i + 1] * window[i];
+        }
+        fft::transform(work.data(), n, twiddle.data());
+        for (int i = 0; i < n; i++) {
+            power[i] += (double)work[2 * i] * work[2 * i] + (double)work[2 * i + 1] * work[2 * i + 1];
+        }
+    }
+    for (int i = 0; i < n; i++) { power[i] = 10.0 * log10(power[i] + 1e-20); }
+
+    std::vector<double> sorted = power;
+    std::nth_element(sorted.begin(), sorted.begin() + n / 2, sorted.end());
+    double median = sorted[n / 2];
+
+    // Signed bins, kept clear of DC and of the filter rolloff at the edges
+    double binHz = params.sampleRate / (double)n;
+    double search = PPM_CAL_SEARCH_PPM * 1e-6 * params.refFreq;
+    int lo = std::max<int>((int)floor((offset - search) / binHz), -(int)(n * 0.45));
+    int hi = std::min<int>((int)ceil((offset + search) / binHz), (int)(n * 0.45));
+    auto bin = [&](int b) { return power[(b + n) % n]; };
+
+    int peak = 0;
+    double peakDb = -1e9;
+    for (int b = lo; b <= hi; b++) {
+        if (abs(b) <= 2) { continue; }
+        if (bin(b) > peakDb) {
+            peakDb = bin(b);
+            peak = b;
+        }
+    }
+    snr = peakDb - median;
+    if (snr < PPM_CAL_MIN_SNR) { return false; }
+
+    // Parabola through the log power, close to exact on a Hann window peak
+    double a = bin(peak - 1);
+    double c = bin(peak + 1);
+    double den = a - 2.0 * peakDb + c;
+    double delta = (den < 0.0) ? std::clamp<double>(0.5 * (a - c) / den, -0.5, 0.5) : 0.0;
+    freq = ((double)peak + delta) * binHz;
+    return true;
+}
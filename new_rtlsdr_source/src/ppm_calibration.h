@@ -0,0 +1,101 @@
+#pragma once
+#include <stdint.h>
+#include <thread>
+#include <mutex>
+#include <atomic>
+#include <vector>
+#include <condition_variable>
+#include "rtlsdr_interface.h"
+
+#define PPM_CAL_FFT_SIZE        16384
+
+// How far off the reference may be, the search window around where it should show up
+#define PPM_CAL_SEARCH_PPM      150.0
+
+// Carrier over the median bin needed to trust the peak
+#define PPM_CAL_MIN_SNR         15.0
+
+#define PPM_CAL_MAX_ITERATIONS  4
+
+struct PpmCalParams {
+    double refFreq;
+    double sampleRate;
+    int ppm;                // Correction in effect when starting
+    double dwell;           // s of signal averaged per measurement
+    double settle;          // s discarded after every retune on top of what was already in flight
+    double interval;        // s between runs, 0 for a single run
+};
+
+// Finds the ppm correction from a known carrier: tunes below the reference so it lands away from DC,
+// averages FFT power over the dwell, interpolates the peak and turns the frequency error into ppm.
+// The correction is applied and measured again until the whole ppm value stops changing.
+class PpmCalibrator {
+public:
+    // Retunes the device, returns how many samples that are already on their way predate the retune
+    typedef uint64_t (*tune_t)(double freq, void* ctx);
+
+    // Applies a new correction
+    typedef void (*apply_t)(int ppm, void* ctx);
+
+    // Called from the calibration thread after every run, the tuner is free again
+    typedef void (*done_t)(void* ctx);
+
+    ~PpmCalibrator();
+
+    bool start(const PpmCalParams& params, tune_t tune, apply_t apply, done_t done, void* ctx);
+    void stop();
+
+    // The correction was changed by hand, the next scheduled run starts from it
+    void setPpm(int ppm);
+    bool isRunning() { return running; }
+
+    // True while it owns the tuner
+    bool isActive() { return active; }
+
+    // Converter thread, full rate interleaved samples
+    void feed(const float* data, int count);
+
+    RTLSDRPpmCalibration get();
+
+private:
+    enum {
+        PPM_CAL_STATE_IDLE,
+        PPM_CAL_STATE_CAPTURE,
+        PPM_CAL_STATE_DONE
+    };
+
+    void worker();
+    bool run();
+    bool capture(double freq);
+    bool estimate(double& freq, double& snr);
+
+    PpmCalParams params;
+    tune_t tune = NULL;
+    apply_t apply = NULL;
+    done_t done = NULL;
+    void* ctx = NULL;
+    double offset = 0.0;
+
+    std::thread workerThread;
+    std::mutex mtx;
+    std::condition_variable cnd;
+    std::atomic<bool> running = false;
+    std::atomic<bool> active = false;
+    std::atomic<int> state = PPM_CAL_STATE_IDLE;
+    std::atomic<int> userPpm = 0;
+    std::atomic<bool> userPpmSet = false;
+
+    // Only touched by feed() while capturing
+    uint64_t discard = 0;
+    int captured = 0;
+    int captureSize = 0;
+    std::vector<float> captureBuf;
+
+    std::vector<float> window;
+    std::vector<float> twiddle;
+    std::vector<float> work;
+    std::vector<double> power;
+
+    std::mutex resultMtx;
+    RTLSDRPpmCalibration result = {};
+};
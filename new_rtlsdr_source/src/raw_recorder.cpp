@@ -0,0 +1,246 @@
+#include "raw_recorder.h"
+#include <time.h>
+#include <new>
+#include <algorithm>
+#include <utils/flog.h>
+
+// Disk writes are done in multiples of this, aligned to the page size
+#define RAW_REC_STAGE_SIZE      (4 * 1024 * 1024)
+#define RAW_REC_STAGE_ALIGN     4096
+
+// How much the writer thread can fall behind before blocks get dropped
+#define RAW_REC_RING_BYTES      (32 * 1024 * 1024)
+
+RawRecorder::~RawRecorder() {
+    stop();
+}
+
+bool RawRecorder::start(const std::string& path, double sampleRate, double freq, const json& info, int blockSize) {
+    if (recording) { return false; }
+
+    file = fopen((path + ".sigmf-data").c_str(), "wb");
+    if (!file) {
+        flog::error("Could not open '{0}' for raw recording", path + ".sigmf-data");
+        return false;
+    }
+    setvbuf(file, NULL, _IONBF, 0);
+    this->path = path;
+
+    timeFile = fopen((path + ".timestamps.csv").c_str(), "w");
+    if (timeFile) {
+        fprintf(timeFile, "sample,device_sample,host_ns,model_ns\n");
+    }
+    else {
+        flog::error("Could not open '{0}', recording without timestamps", path + ".timestamps.csv");
+    }
+
+    stage = (uint8_t*)::operator new(RAW_REC_STAGE_SIZE, std::align_val_t(RAW_REC_STAGE_ALIGN));
+    stageFill = 0;
+    ring.init(std::max<int>(RAW_REC_RING_BYTES / blockSize, 16), blockSize);
+
+    receivedBytes = 0;
+    writtenBytes = 0;
+    droppedBytes = 0;
+    eventHead = 0;
+    eventTail = 0;
+    lostEvents = 0;
+    dropSamples = 0;
+
+    {
+        std::lock_guard<std::mutex> lck(metaMtx);
+        meta = json({});
+        meta["global"] = info;
+        meta["global"]["core:datatype"] = "cu8";
+        meta["global"]["core:sample_rate"] = sampleRate;
+        meta["global"]["core:version"] = "1.0.0";
+        meta["global"]["core:recorder"] = "SDR++ new_rtlsdr_source";
+        meta["captures"] = json::array();
+        meta["annotations"] = json::array();
+    }
+    retune(freq);
+
+    writerThread = std::thread(&RawRecorder::writer, this);
+    recording = true;
+    flog::info("Raw recording to '{0}'", path);
+    return true;
+}
+
+void RawRecorder::stop() {
+    if (!recording) { return; }
+    recording = false;
+    while (inWrite) { std::this_thread::yield(); }
+
+    ring.stop();
+    if (writerThread.joinable()) { writerThread.join(); }
+
+    // Nothing writes events anymore, a drop still going on ends here
+    if (dropSamples) {
+        pushEvent(NULL, dropStart, dropSamples);
+        dropSamples = 0;
+    }
+    drainEvents();
+
+    if (stageFill) {
+        writtenBytes += fwrite(stage, 1, stageFill, file);
+        stageFill = 0;
+    }
+    fclose(file);
+    file = NULL;
+    if (timeFile) {
+        fclose(timeFile);
+        timeFile = NULL;
+    }
+    ::operator delete(stage, std::align_val_t(RAW_REC_STAGE_ALIGN));
+    stage = NULL;
+    ring.free();
+
+    writeMeta();
+    flog::info("Raw recording stopped, {0} bytes written, {1} bytes dropped", (uint64_t)writtenBytes, (uint64_t)droppedBytes);
+}
+
+void RawRecorder::write(const uint8_t* buf, int len, const BlockStamp& stamp) {
+    // stop() waits for this to reach zero before tearing down the ring
+    inWrite++;
+    if (!recording) {
+        inWrite--;
+        return;
+    }
+
+    uint64_t fileBytes = receivedBytes - droppedBytes;
+    receivedBytes += len;
+    if (!ring.push(buf, len, stamp)) {
+        // Never wait on the disk, leave a hole in the file and say so in the metadata
+        droppedBytes += len;
+        if (!dropSamples) { dropStart = fileBytes / 2; }
+        dropSamples += len / 2;
+    }
+    else if (dropSamples) {
+        pushEvent(NULL, dropStart, dropSamples);
+        dropSamples = 0;
+    }
+    inWrite--;
+}
+
+void RawRecorder::mark(const char* comment) {
+    inWrite++;
+    if (recording) { pushEvent(comment, (receivedBytes - droppedBytes) / 2, 0); }
+    inWrite--;
+}
+
+void RawRecorder::pushEvent(const char* comment, uint64_t sample, uint64_t dropped) {
+    size_t h = eventHead.load(std::memory_order_relaxed);
+    if (h - eventTail.load(std::memory_order_acquire) >= RAW_REC_EVENTS) {
+        lostEvents++;
+        return;
+    }
+    events[h % RAW_REC_EVENTS] = Event { comment, sample, dropped };
+    eventHead.store(h + 1, std::memory_order_release);
+}
+
+void RawRecorder::drainEvents() {
+    size_t t = eventTail.load(std::memory_order_relaxed);
+    size_t h = eventHead.load(std::memory_order_acquire);
+    uint64_t lost = lostEvents.exchange(0);
+    if (t == h && !lost) { return; }
+
+    std::lock_guard<std::mutex> lck(metaMtx);
+    for (; t != h; t++) {
+        const Event& e = events[t % RAW_REC_EVENTS];
+        json ann = json({});
+        ann["core:sample_start"] = e.sample;
+        ann["core:sample_count"] = 0;
+        ann["core:comment"] = e.comment ? std::string(e.comment) : ("dropped " + std::to_string(e.dropped) + " samples");
+        meta["annotations"].push_back(ann);
+    }
+    eventTail.store(t, std::memory_order_release);
+
+    if (lost) {
+        json ann = json({});
+        ann["core:sample_start"] = (receivedBytes - droppedBytes) / 2;
+        ann["core:sample_count"] = 0;
+        ann["core:comment"] = std::to_string(lost) + " earlier annotations lost, the writer fell behind";
+        meta["annotations"].push_back(ann);
+    }
+}
+
+void RawRecorder::retune(double freq) {
+    std::lock_guard<std::mutex> lck(metaMtx);
+    json cap = json({});
+    cap["core:sample_start"] = (receivedBytes - droppedBytes) / 2;
+    cap["core:frequency"] = freq;
+    cap["core:datetime"] = isoTime();
+    meta["captures"].push_back(cap);
+}
+
+void RawRecorder::annotate(const std::string& comment) {
+    std::lock_guard<std::mutex> lck(metaMtx);
+    json ann = json({});
+    ann["core:sample_start"] = (receivedBytes - droppedBytes) / 2;
+    ann["core:sample_count"] = 0;
+    ann["core:comment"] = comment;
+    meta["annotations"].push_back(ann);
+}
+
+void RawRecorder::setGlobal(const std::string& key, const json& value) {
+    std::lock_guard<std::mutex> lck(metaMtx);
+    meta["global"][key] = value;
+}
+
+void RawRecorder::writer() {
+    int len;
+    BlockStamp stamp;
+    uint64_t fileSamples = 0;
+    while (true) {
+        uint8_t* buf = ring.pop(len, &stamp);
+        drainEvents();
+        if (!buf) { break; }
+
+        if (timeFile) {
+            fprintf(timeFile, "%llu,%llu,%lld,%lld\n", (unsigned long long)fileSamples, (unsigned long long)stamp.index,
+                    (long long)stamp.hostTime, (long long)stamp.modelTime);
+        }
+        fileSamples += len / 2;
+
+        int off = 0;
+        while (off < len) {
+            size_t n = std::min<size_t>(len - off, RAW_REC_STAGE_SIZE - stageFill);
+            memcpy(&stage[stageFill], &buf[off], n);
+            stageFill += n;
+            off += n;
+            if (stageFill == RAW_REC_STAGE_SIZE) {
+                size_t written = fwrite(stage, 1, RAW_REC_STAGE_SIZE, file);
+                if (written != RAW_REC_STAGE_SIZE) {
+                    flog::error("Raw recording write failed");
+                }
+                writtenBytes += written;
+                stageFill = 0;
+            }
+        }
+        ring.release();
+    }
+}
+
+void RawRecorder::writeMeta() {
+    FILE* mf = fopen((path + ".sigmf-meta").c_str(), "w");
+    if (!mf) {
+        flog::error("Could not write '{0}'", path + ".sigmf-meta");
+        return;
+    }
+    std::lock_guard<std::mutex> lck(metaMtx);
+    std::string str = meta.dump(4);
+    fwrite(str.c_str(), 1, str.size(), mf);
+    fclose(mf);
+}
+
+std::string RawRecorder::isoTime() {
+    time_t now = time(NULL);
+    tm ltm;
+#ifdef _WIN32
+    gmtime_s(&ltm, &now);
+#else
+    gmtime_r(&now, &ltm);
+#endif
+    char buf[64];
+    strftime(buf, sizeof(buf), "%Y-%m-%dT%H:%M:%SZ", &ltm);
+    return buf;
+}
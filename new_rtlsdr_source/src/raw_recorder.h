@@ -0,0 +1,88 @@
+#pragma once
+#include <stdint.h>
+#include <stdio.h>
+#include <string>
+#include <thread>
+#include <mutex>
+#include <atomic>
+#include <config.h>
+#include "spsc_ring.h"
+
+// Annotations the usb thread can have pending before the writer picks them up
+#define RAW_REC_EVENTS          256
+
+// Writes the untouched CU8 usb buffers to <path>.sigmf-data and a SigMF sidecar to <path>.sigmf-meta.
+// Every block's timestamps go to <path>.timestamps.csv, one line per block.
+// write() is called from the libusb thread and only copies into a ring, a dedicated thread does the
+// disk io in large aligned chunks so a slow disk can only ever cause dropped (and annotated) blocks.
+// The usb thread never locks or allocates, its annotations go through a fixed queue to the writer.
+class RawRecorder {
+public:
+    ~RawRecorder();
+
+    // info ends up in the global object of the metadata, blockSize is the largest buffer write() gets
+    bool start(const std::string& path, double sampleRate, double freq, const json& info, int blockSize);
+    void stop();
+
+    bool isRecording() { return recording; }
+
+    // Usb thread only
+    void write(const uint8_t* buf, int len, const BlockStamp& stamp = BlockStamp());
+
+    // Usb thread only, annotates the current sample. comment has to be a literal, only the pointer is kept.
+    void mark(const char* comment);
+
+    // Adds a capture segment starting at the current sample
+    void retune(double freq);
+
+    // Adds an annotation at the current sample
+    void annotate(const std::string& comment);
+
+    // Sets a key of the global object of the metadata
+    void setGlobal(const std::string& key, const json& value);
+
+    uint64_t getWrittenBytes() { return writtenBytes; }
+    uint64_t getDroppedBytes() { return droppedBytes; }
+    std::string getPath() { return path; }
+
+private:
+    struct Event {
+        const char* comment;    // NULL for dropped samples
+        uint64_t sample;
+        uint64_t dropped;
+    };
+
+    void pushEvent(const char* comment, uint64_t sample, uint64_t dropped);
+    void drainEvents();
+    void writer();
+    void writeMeta();
+    static std::string isoTime();
+
+    std::string path;
+    FILE* file = NULL;
+    FILE* timeFile = NULL;
+    std::thread writerThread;
+    SPSCRing ring;
+
+    uint8_t* stage = NULL;
+    size_t stageFill = 0;
+
+    std::atomic<bool> recording = false;
+    std::atomic<int> inWrite = 0;
+    std::atomic<uint64_t> receivedBytes = 0;
+    std::atomic<uint64_t> writtenBytes = 0;
+    std::atomic<uint64_t> droppedBytes = 0;
+
+    // Written by the usb thread, read by the writer (and stop() once the usb thread is out)
+    Event events[RAW_REC_EVENTS];
+    alignas(64) std::atomic<size_t> eventHead = 0;
+    alignas(64) std::atomic<size_t> eventTail = 0;
+    std::atomic<uint64_t> lostEvents = 0;
+
+    // Usb thread only, the drop currently going on is annotated once it ends
+    uint64_t dropStart = 0;
+    uint64_t dropSamples = 0;
+
+    std::mutex metaMtx;
+    json meta;
+};
@@ -0,0 +1,58 @@
+#include "raw_tap.h"
+
+void RawTap::init(int maxBytes, uint8_t* mem) {
+    std::lock_guard<std::mutex> lck(mtx);
+    if (!mem) {
+        data.resize(bytes(maxBytes));
+        mem = data.data();
+    }
+    cs16 = (int16_t*)mem;
+    cs8 = (int8_t*)&cs16[maxBytes];
+}
+
+void RawTap::add(const RTLSDRRawSink& sink) {
+    if (!sink.handler || sink.format < 0 || sink.format >= RAW_TAP_FORMAT_COUNT) { return; }
+    std::lock_guard<std::mutex> lck(mtx);
+    sinks.push_back(sink);
+    if (sink.replacesStream) { replacing++; }
+    count = sinks.size();
+}
+
+void RawTap::remove(const RTLSDRRawSink& sink) {
+    std::lock_guard<std::mutex> lck(mtx);
+    for (auto it = sinks.begin(); it != sinks.end(); it++) {
+        if (it->handler == sink.handler && it->ctx == sink.ctx) {
+            if (it->replacesStream) { replacing--; }
+            sinks.erase(it);
+            break;
+        }
+    }
+    count = sinks.size();
+}
+
+void RawTap::process(const uint8_t* buf, int len, const RTLSDRBlockTime& time) {
+    std::lock_guard<std::mutex> lck(mtx);
+    int samples = len / 2;
+    bool packed[RAW_TAP_FORMAT_COUNT] = {};
+    for (const auto& s : sinks) {
+        const void* data = buf;
+        if (s.format == RTLSDR_RAW_CS8) {
+            if (!packed[RTLSDR_RAW_CS8]) { packCS8(buf, cs8, len); }
+            data = cs8;
+        }
+        else if (s.format == RTLSDR_RAW_CS16) {
+            if (!packed[RTLSDR_RAW_CS16]) { packCS16(buf, cs16, len); }
+            data = cs16;
+        }
+        packed[s.format] = true;
+        s.handler(data, samples, &time, s.ctx);
+    }
+}
+
+void RawTap::packCS8(const uint8_t* in, int8_t* out, int count) {
+    for (int i = 0; i < count; i++) { out[i] = (int8_t)(in[i] ^ 0x80); }
+}
+
+void RawTap::packCS16(const uint8_t* in, int16_t* out, int count) {
+    for (int i = 0; i < count; i++) { out[i] = (int16_t)(((int)in[i] - 128) * 256); }
+}
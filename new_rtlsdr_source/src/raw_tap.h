@@ -0,0 +1,43 @@
+#pragma once
+#include <stdint.h>
+#include <mutex>
+#include <atomic>
+#include <vector>
+#include "rtlsdr_interface.h"
+
+#define RAW_TAP_FORMAT_COUNT    3
+
+// Hands the usb blocks to other modules in a native integer format, each format is packed at most
+// once per block whatever the number of sinks wanting it. Once every sink carries the samples itself,
+// the float conversion can be skipped entirely.
+class RawTap {
+public:
+    // Largest block process() gets, in bytes of CU8. mem (bytes(maxBytes) of it) holds the packed
+    // blocks if given, it must outlive the tap.
+    void init(int maxBytes, uint8_t* mem = NULL);
+    static size_t bytes(int maxBytes) { return (size_t)maxBytes * (sizeof(int8_t) + sizeof(int16_t)); }
+
+    void add(const RTLSDRRawSink& sink);
+    void remove(const RTLSDRRawSink& sink);
+
+    bool empty() { return !count; }
+    int getCount() { return count; }
+
+    // Every sink replaces the float stream
+    bool replacesStream() { return count && replacing == count; }
+
+    // Converter thread
+    void process(const uint8_t* buf, int len, const RTLSDRBlockTime& time);
+
+    static void packCS8(const uint8_t* in, int8_t* out, int count);
+    static void packCS16(const uint8_t* in, int16_t* out, int count);
+
+private:
+    std::mutex mtx;
+    std::vector<RTLSDRRawSink> sinks;
+    std::atomic<int> count = 0;
+    std::atomic<int> replacing = 0;
+    std::vector<uint8_t> data;
+    int8_t* cs8 = NULL;
+    int16_t* cs16 = NULL;
+};
@@ -0,0 +1,124 @@
+#include "replay_device.h"
+#include <chrono>
+#include <thread>
+#include <string.h>
+#include <utils/flog.h>
+
+#define REPLAY_MAX_CALLS    4096
+
+// Same table librtlsdr reports for the R820T so the gain slider behaves like with a dongle
+static const int r820tGains[] = {
+    0, 9, 14, 27, 37, 77, 87, 125, 144, 157, 166, 197, 207, 229, 254,
+    280, 297, 328, 338, 364, 372, 386, 402, 421, 434, 439, 445, 480, 496
+};
+
+static double nowSeconds() {
+    return std::chrono::duration<double>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+ReplayDevice::ReplayDevice(const std::string& path, int pacing, bool loop) {
+    this->pacing = pacing;
+    this->loop = loop;
+    openTime = nowSeconds();
+    file = fopen(path.c_str(), "rb");
+    if (!file) {
+        flog::error("Could not open replay file '{0}'", path);
+    }
+}
+
+ReplayDevice::~ReplayDevice() {
+    if (file) { fclose(file); }
+}
+
+int ReplayDevice::setSampleRate(uint32_t rate) {
+    sampleRate = rate;
+    return recordTuner("set_sample_rate", rate);
+}
+
+int ReplayDevice::setCenterFreq(uint32_t freq) {
+    this->freq = freq;
+    return recordTuner("set_center_freq", freq);
+}
+
+int ReplayDevice::setTunerI2cRegister(unsigned reg, unsigned mask, unsigned data) {
+    return record("set_tuner_i2c_register", ((int64_t)reg << 16) | ((mask & 0xFF) << 8) | (data & 0xFF));
+}
+
+int ReplayDevice::getTunerI2cRegister(unsigned char* data, int* len, int* strength) {
+    // All zero but the PLL lock bit, a replay always "locks"
+    memset(data, 0, *len);
+    if (*len > 2) { data[2] = 0x40; }
+    *strength = 0;
+    return 0;
+}
+
+int ReplayDevice::getTunerGains(int* gains) {
+    int n = sizeof(r820tGains) / sizeof(int);
+    if (gains) { memcpy(gains, r820tGains, sizeof(r820tGains)); }
+    return n;
+}
+
+int ReplayDevice::readAsync(rtlsdr_read_async_cb_t cb, void* ctx, uint32_t bufNum, uint32_t bufLen) {
+    if (!file) { return -1; }
+    std::vector<unsigned char> buf(bufLen);
+
+    auto start = std::chrono::steady_clock::now();
+    uint64_t sent = 0;
+
+    while (!cancel) {
+        size_t n = fread(buf.data(), 1, bufLen, file);
+        while (n < bufLen && loop) {
+            rewind(file);
+            size_t m = fread(&buf[n], 1, bufLen - n, file);
+            if (!m) { break; }
+            n += m;
+        }
+        n &= ~(size_t)1;
+        if (!n) { break; }
+
+        if (pacing == REPLAY_PACING_REALTIME) {
+            double t = (double)(sent / 2) / (double)sampleRate;
+            std::this_thread::sleep_until(start + std::chrono::duration_cast<std::chrono::steady_clock::duration>(std::chrono::duration<double>(t)));
+        }
+        if (cancel) { break; }
+
+        cb(buf.data(), n, ctx);
+        sent += n;
+        if (n < bufLen) { break; }
+    }
+    return 0;
+}
+
+int ReplayDevice::cancelAsync() {
+    cancel = true;
+    return 0;
+}
+
+std::vector<ReplayCall> ReplayDevice::getCalls() {
+    std::lock_guard<std::mutex> lck(callMtx);
+    return calls;
+}
+
+int ReplayDevice::getCallCount() {
+    std::lock_guard<std::mutex> lck(callMtx);
+    return calls.size();
+}
+
+bool ReplayDevice::getLastCall(ReplayCall& call) {
+    std::lock_guard<std::mutex> lck(callMtx);
+    if (calls.empty()) { return false; }
+    call = calls.back();
+    return true;
+}
+
+int ReplayDevice::record(const char* call, int64_t value) {
+    std::lock_guard<std::mutex> lck(callMtx);
+    if (calls.size() >= REPLAY_MAX_CALLS) { calls.erase(calls.begin()); }
+    calls.push_back({ nowSeconds() - openTime, call, value });
+    return 0;
+}
+
+int ReplayDevice::recordTuner(const char* call, int64_t value) {
+    tunerRegs.invalidate(this);
+    return record(call, value);
+}
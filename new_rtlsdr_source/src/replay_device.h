@@ -0,0 +1,77 @@
+#pragma once
+#include <stdio.h>
+#include <string>
+#include <vector>
+#include <mutex>
+#include <atomic>
+#include "rtl_device.h"
+
+enum ReplayPacing {
+    REPLAY_PACING_REALTIME,
+    REPLAY_PACING_MAX_SPEED
+};
+
+struct ReplayCall {
+    double time;        // Seconds since the device was opened
+    std::string call;
+    int64_t value;
+};
+
+// Pseudo dongle streaming a CU8 file (raw recordings or rtl_sdr captures) through the normal
+// async callback. Tuning and gain calls do nothing but are kept in a call log.
+class ReplayDevice : public RTLDevice {
+public:
+    ReplayDevice(const std::string& path, int pacing, bool loop);
+    ~ReplayDevice();
+
+    bool isOpen() { return file != NULL; }
+
+    int setSampleRate(uint32_t rate);
+    int setCenterFreq(uint32_t freq);
+    uint32_t getCenterFreq() { return freq; }
+    int setFreqCorrection(int ppm) { return recordTuner("set_freq_correction", ppm); }
+    int setTunerBandwidth(uint32_t bw) { return recordTuner("set_tuner_bandwidth", bw); }
+    int setDirectSampling(int on) { return recordTuner("set_direct_sampling", on); }
+    int setBiasTee(int on) { return record("set_bias_tee", on); }
+    int setAgcMode(int on) { return record("set_agc_mode", on); }
+    int setOffsetTuning(int on) { return recordTuner("set_offset_tuning", on); }
+    int setIfFreq(uint32_t freq) { return recordTuner("set_if_freq", freq); }
+    int setTunerSideband(int sideband) { return recordTuner("set_tuner_sideband", sideband); }
+    int setTunerGain(int gain) { return recordTuner("set_tuner_gain", gain); }
+    int setTunerGainMode(int mode) { return recordTuner("set_tuner_gain_mode", mode); }
+    int setTunerGainIndex(unsigned int index) { return recordTuner("set_tuner_gain_index", index); }
+    int setTunerI2cRegister(unsigned reg, unsigned mask, unsigned data);
+    int getTunerI2cRegister(unsigned char* data, int* len, int* strength);
+    int getDagcGain() { return 0; }
+    rtlsdr_tuner getTunerType() { return RTLSDR_TUNER_R820T; }
+    int getTunerGains(int* gains);
+
+    int resetBuffer() { return 0; }
+    int readAsync(rtlsdr_read_async_cb_t cb, void* ctx, uint32_t bufNum, uint32_t bufLen);
+    int cancelAsync();
+
+    bool isRealtime() { return pacing == REPLAY_PACING_REALTIME; }
+
+    std::vector<ReplayCall> getCalls();
+    int getCallCount();
+    bool getLastCall(ReplayCall& call);
+
+private:
+    int record(const char* call, int64_t value);
+    // Same shadow register invalidation as a dongle so the call log matches
+    int recordTuner(const char* call, int64_t value);
+
+    FILE* file = NULL;
+    int pacing;
+    bool loop;
+    uint32_t sampleRate = 2400000;
+    uint32_t freq = 0;
+
+    // Never cleared, a cancel that comes in before readAsync() starts must still end it. A replay is
+    // reopened for every start, it's never kept in standby.
+    std::atomic<bool> cancel = false;
+
+    double openTime;
+    std::mutex callMtx;
+    std::vector<ReplayCall> calls;
+};
@@ -0,0 +1,217 @@
+#pragma once
+#include <stdint.h>
+#include <string.h>
+#include <math.h>
+#include <atomic>
+#include <chrono>
+#include <deque>
+#include <mutex>
+#include <vector>
+#include <algorithm>
+#include "rtlsdr_interface.h"
+
+#define RETUNE_MAX_MARKERS          64
+#define RETUNE_DEFAULT_SETTLE       0.005
+
+// Settle time measurement: power of RETUNE_MEASURE_WINDOW sample windows over RETUNE_MEASURE_TIME after
+// the retune, settled once within RETUNE_MEASURE_TOLERANCE dB of the level at the end of the trace
+#define RETUNE_MEASURE_TIME         0.05
+#define RETUNE_MEASURE_WINDOW       64
+#define RETUNE_MEASURE_TOLERANCE    1.5
+
+enum SettleMode {
+    SETTLE_MODE_OFF,
+    SETTLE_MODE_BLANK,      // Zero the settling window, timing is preserved
+    SETTLE_MODE_DROP        // Remove the settling window from the stream
+};
+
+// Keeps track of the sample index every retune takes effect at. The usb thread numbers the blocks as they
+// complete, a retune lands after everything that already completed plus the part of the transfer that was
+// being filled (estimated from the time since the last completion). The converter thread then resolves
+// the markers into stream positions and blanks or drops the settling windows.
+class RetuneTracker {
+public:
+    void reset(double sampleRate, int blockSamples) {
+        this->sampleRate = sampleRate;
+        this->blockSamples = blockSamples;
+        received = 0;
+        converted = 0;
+        lastBlock = 0;
+        settleStart = 0;
+        settleEnd = 0;
+        std::lock_guard<std::mutex> lck(mtx);
+        markers.clear();
+        unresolved = 0;
+        measureState = MEASURE_IDLE;
+    }
+
+    void setSettle(double seconds) { settle = seconds; }
+    double getSettle() { return settle; }
+    void setMode(int mode) { this->mode = mode; }
+
+    // Usb thread, returns the index of the first sample of the block
+    uint64_t block(uint32_t samples) {
+        uint64_t index = received.fetch_add(samples);
+        lastBlock = std::chrono::steady_clock::now().time_since_epoch().count();
+        return index;
+    }
+
+    // Right after the tuner was reprogrammed, returns the sample index the new frequency starts at.
+    // With measure set the power trace following the marker is recorded for getMeasurement().
+    uint64_t mark(double freq, bool measure = false) {
+        int64_t now = std::chrono::steady_clock::now().time_since_epoch().count();
+        double since = (double)(now - lastBlock.load()) * std::chrono::steady_clock::period::num / std::chrono::steady_clock::period::den;
+        uint64_t partial = (uint64_t)std::clamp<double>(since * sampleRate, 0.0, (double)blockSamples);
+
+        RTLSDRRetuneMarker m;
+        m.sampleIndex = received.load() + partial;
+        m.streamIndex = RTLSDR_STREAM_INDEX_PENDING;
+        m.freq = freq;
+        m.settleSamples = (uint32_t)(settle * sampleRate);
+        m.time = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::system_clock::now().time_since_epoch()).count();
+
+        std::lock_guard<std::mutex> lck(mtx);
+        if (markers.size() >= RETUNE_MAX_MARKERS) {
+            if (markers.front().streamIndex == RTLSDR_STREAM_INDEX_PENDING) { unresolved--; }
+            markers.pop_front();
+        }
+        markers.push_back(m);
+        unresolved++;
+        if (measure) {
+            measureIndex = m.sampleIndex;
+            trace.clear();
+            trace.reserve((size_t)(RETUNE_MEASURE_TIME * sampleRate / RETUNE_MEASURE_WINDOW) + 1);
+            windowPower = 0.0;
+            windowFill = 0;
+            measureState = MEASURE_ARMED;
+        }
+        return m.sampleIndex;
+    }
+
+    // Converter thread. index: first sample of the block, outPos: samples written to the stream so far,
+    // decimShift: log2 of the decimation applied afterwards. Returns the new sample count.
+    int apply(float* data, int count, uint64_t index, uint64_t outPos, int decimShift) {
+        uint64_t end = index + count;
+        if (unresolved) {
+            std::lock_guard<std::mutex> lck(mtx);
+            for (auto& m : markers) {
+                if (m.streamIndex != RTLSDR_STREAM_INDEX_PENDING || m.sampleIndex >= end) { continue; }
+                uint64_t offset = (m.sampleIndex > index) ? m.sampleIndex - index : 0;
+                uint64_t dropped = (mode == SETTLE_MODE_DROP) ? droppedBefore(index, offset) : 0;
+                m.streamIndex = outPos + ((offset - dropped) >> decimShift);
+                // A window still open, or started by an earlier marker in this block, keeps its start
+                uint64_t start = std::max<uint64_t>(m.sampleIndex, index);
+                if (settleEnd <= index || start < settleStart) { settleStart = start; }
+                settleEnd = std::max<uint64_t>(settleEnd, m.sampleIndex + m.settleSamples);
+                unresolved--;
+                if (measureState == MEASURE_ARMED && m.sampleIndex == measureIndex) {
+                    measureState = MEASURE_CAPTURE;
+                }
+            }
+        }
+
+        if (measureState == MEASURE_CAPTURE) {
+            // mark() can rearm (and clear the trace) at any time
+            std::lock_guard<std::mutex> lck(mtx);
+            if (measureState == MEASURE_CAPTURE) { measure(data, count, index); }
+        }
+
+        converted = end;
+        if (mode == SETTLE_MODE_OFF || settleEnd <= index || settleStart >= end) { return count; }
+
+        int from = (int)(std::max<uint64_t>(settleStart, index) - index);
+        int to = (int)(std::min<uint64_t>(settleEnd, end) - index);
+        if (mode == SETTLE_MODE_BLANK) {
+            memset(&data[from * 2], 0, (size_t)(to - from) * 2 * sizeof(float));
+            return count;
+        }
+        memmove(&data[from * 2], &data[to * 2], (size_t)(count - to) * 2 * sizeof(float));
+        return count - (to - from);
+    }
+
+    // Samples the converter went through, same numbering as the markers
+    uint64_t getConverted() { return converted; }
+
+    std::vector<RTLSDRRetuneMarker> getMarkers() {
+        std::lock_guard<std::mutex> lck(mtx);
+        return std::vector<RTLSDRRetuneMarker>(markers.begin(), markers.end());
+    }
+
+    // True once the trace is complete, the result is the settle time in seconds
+    bool getMeasurement(double& seconds) {
+        if (measureState != MEASURE_DONE) { return false; }
+        std::lock_guard<std::mutex> lck(mtx);
+        if (measureState != MEASURE_DONE) { return false; }
+        measureState = MEASURE_IDLE;
+        if (trace.size() < 8) {
+            seconds = 0.0;
+            return true;
+        }
+
+        // The end of the trace is the settled level
+        std::vector<float> tail(trace.begin() + trace.size() / 2, trace.end());
+        std::nth_element(tail.begin(), tail.begin() + tail.size() / 2, tail.end());
+        double steady = tail[tail.size() / 2] + 1e-20;
+
+        int last = -1;
+        for (int i = 0; i < (int)trace.size() / 2; i++) {
+            if (fabs(10.0 * log10((trace[i] + 1e-20) / steady)) > RETUNE_MEASURE_TOLERANCE) { last = i; }
+        }
+        seconds = (double)((last + 1) * RETUNE_MEASURE_WINDOW) / sampleRate;
+        return true;
+    }
+
+private:
+    enum {
+        MEASURE_IDLE,
+        MEASURE_ARMED,
+        MEASURE_CAPTURE,
+        MEASURE_DONE
+    };
+
+    // Part of [index, index + offset) that falls in the current settling window
+    uint64_t droppedBefore(uint64_t index, uint64_t offset) {
+        uint64_t from = std::max<uint64_t>(settleStart, index);
+        uint64_t to = std::min<uint64_t>(settleEnd, index + offset);
+        return (to > from) ? to - from : 0;
+    }
+
+    // Holding mtx
+    void measure(const float* data, int count, uint64_t index) {
+        int i = (measureIndex > index) ? (int)(measureIndex - index) : 0;
+        size_t maxPoints = (size_t)(RETUNE_MEASURE_TIME * sampleRate / RETUNE_MEASURE_WINDOW);
+        for (; i < count && trace.size() < maxPoints; i++) {
+            windowPower += data[2 * i] * data[2 * i] + data[2 * i + 1] * data[2 * i + 1];
+            if (++windowFill == RETUNE_MEASURE_WINDOW) {
+                trace.push_back(windowPower / RETUNE_MEASURE_WINDOW);
+                windowPower = 0.0;
+                windowFill = 0;
+            }
+        }
+        if (trace.size() >= maxPoints) { measureState = MEASURE_DONE; }
+    }
+
+    double sampleRate = 1.0;
+    int blockSamples = 0;
+    std::atomic<double> settle = RETUNE_DEFAULT_SETTLE;
+    std::atomic<int> mode = SETTLE_MODE_OFF;
+
+    std::atomic<uint64_t> received = 0;
+    std::atomic<uint64_t> converted = 0;
+    std::atomic<int64_t> lastBlock = 0;
+
+    // Converter thread only
+    uint64_t settleStart = 0;
+    uint64_t settleEnd = 0;
+
+    std::mutex mtx;
+    std::deque<RTLSDRRetuneMarker> markers;
+    std::atomic<int> unresolved = 0;
+
+    // Guarded by mtx, measureState is also peeked at without it
+    std::atomic<int> measureState = MEASURE_IDLE;
+    uint64_t measureIndex = 0;
+    std::vector<float> trace;
+    double windowPower = 0.0;
+    int windowFill = 0;
+};
@@ -0,0 +1,104 @@
+#pragma once
+#include <stdint.h>
+#include <rtl-sdr.h>
+#include "tuner_regs.h"
+
+// Everything the module does with a dongle goes through this so that a dongle can be swapped
+// for something else (a replay file). Methods map 1:1 to the librtlsdr call of the same name.
+class RTLDevice {
+public:
+    virtual ~RTLDevice() {}
+
+    virtual int setSampleRate(uint32_t rate) = 0;
+    virtual int setCenterFreq(uint32_t freq) = 0;
+    virtual uint32_t getCenterFreq() = 0;
+    virtual int setFreqCorrection(int ppm) = 0;
+    virtual int setTunerBandwidth(uint32_t bw) = 0;
+    virtual int setDirectSampling(int on) = 0;
+    virtual int setBiasTee(int on) = 0;
+    virtual int setAgcMode(int on) = 0;
+    virtual int setOffsetTuning(int on) = 0;
+    virtual int setIfFreq(uint32_t freq) = 0;
+    virtual int setTunerSideband(int sideband) = 0;
+    virtual int setTunerGain(int gain) = 0;
+    virtual int setTunerGainMode(int mode) = 0;
+    virtual int setTunerGainIndex(unsigned int index) = 0;
+    virtual int setTunerI2cRegister(unsigned reg, unsigned mask, unsigned data) = 0;
+    virtual int getTunerI2cRegister(unsigned char* data, int* len, int* strength) = 0;
+    virtual int getDagcGain() = 0;
+    virtual rtlsdr_tuner getTunerType() = 0;
+    virtual int getTunerGains(int* gains) = 0;
+
+    virtual int resetBuffer() = 0;
+    virtual int readAsync(rtlsdr_read_async_cb_t cb, void* ctx, uint32_t bufNum, uint32_t bufLen) = 0;
+    virtual int cancelAsync() = 0;
+
+    // False if samples don't come at the sample rate (max speed replay), the module then
+    // applies backpressure instead of dropping and skips the usb timing statistics
+    virtual bool isRealtime() { return true; }
+
+    // Strings of the dongle actually opened, buffers are 256 bytes. Negative if there's no usb device behind it.
+    virtual int getUsbStrings(char* manufacturer, char* product, char* serial) { return -1; }
+
+    // Shadowed tuner register writes, only reach the hardware on flushTunerRegs() and only if they change something
+    void queueTunerI2cRegister(int reg, uint8_t mask, uint8_t data) { tunerRegs.write(this, reg, mask, data); }
+    int flushTunerRegs() { return tunerRegs.flush(this); }
+    TunerRegs& getTunerRegs() { return tunerRegs; }
+
+protected:
+    TunerRegs tunerRegs;
+};
+
+class LibRTLDevice : public RTLDevice {
+public:
+    ~LibRTLDevice() {
+        rtlsdr_close(dev);
+    }
+
+    // nullptr on failure, err gets the librtlsdr error code
+    static LibRTLDevice* open(uint32_t index, int& err) {
+        rtlsdr_dev_t* d;
+        err = rtlsdr_open(&d, index);
+        if (err < 0) { return nullptr; }
+        return new LibRTLDevice(d);
+    }
+
+#ifdef __ANDROID__
+    static LibRTLDevice* openSys(int fd, int& err) {
+        rtlsdr_dev_t* d;
+        err = rtlsdr_open_sys_dev(&d, fd);
+        if (err < 0) { return nullptr; }
+        return new LibRTLDevice(d);
+    }
+#endif
+
+    // Calls that make librtlsdr write tuner registers itself invalidate the shadow first
+    int setSampleRate(uint32_t rate) { tunerRegs.invalidate(this); return rtlsdr_set_sample_rate(dev, rate); }
+    int setCenterFreq(uint32_t freq) { tunerRegs.invalidate(this); return rtlsdr_set_center_freq(dev, freq); }
+    uint32_t getCenterFreq() { return rtlsdr_get_center_freq(dev); }
+    int setFreqCorrection(int ppm) { tunerRegs.invalidate(this); return rtlsdr_set_freq_correction(dev, ppm); }
+    int setTunerBandwidth(uint32_t bw) { tunerRegs.invalidate(this); return rtlsdr_set_tuner_bandwidth(dev, bw); }
+    int setDirectSampling(int on) { tunerRegs.invalidate(this); return rtlsdr_set_direct_sampling(dev, on); }
+    int setBiasTee(int on) { return rtlsdr_set_bias_tee(dev, on); }
+    int setAgcMode(int on) { return rtlsdr_set_agc_mode(dev, on); }
+    int setOffsetTuning(int on) { tunerRegs.invalidate(this); return rtlsdr_set_offset_tuning(dev, on); }
+    int setIfFreq(uint32_t freq) { tunerRegs.invalidate(this); return rtlsdr_set_if_freq(dev, freq); }
+    int setTunerSideband(int sideband) { tunerRegs.invalidate(this); return rtlsdr_set_tuner_sideband(dev, sideband); }
+    int setTunerGain(int gain) { tunerRegs.invalidate(this); return rtlsdr_set_tuner_gain(dev, gain); }
+    int setTunerGainMode(int mode) { tunerRegs.invalidate(this); return rtlsdr_set_tuner_gain_mode(dev, mode); }
+    int setTunerGainIndex(unsigned int index) { tunerRegs.invalidate(this); return rtlsdr_set_tuner_gain_index(dev, index); }
+    int setTunerI2cRegister(unsigned reg, unsigned mask, unsigned data) { return rtlsdr_set_tuner_i2c_register(dev, reg, mask, data); }
+    int getTunerI2cRegister(unsigned char* data, int* len, int* strength) { return rtlsdr_get_tuner_i2c_register(dev, data, len, strength); }
+    int getDagcGain() { return rtlsdr_get_dagc_gain(dev); }
+    rtlsdr_tuner getTunerType() { return rtlsdr_get_tuner_type(dev); }
+    int getTunerGains(int* gains) { return rtlsdr_get_tuner_gains(dev, gains); }
+    int getUsbStrings(char* manufacturer, char* product, char* serial) { return rtlsdr_get_usb_strings(dev, manufacturer, product, serial); }
+
+    int resetBuffer() { return rtlsdr_reset_buffer(dev); }
+    int readAsync(rtlsdr_read_async_cb_t cb, void* ctx, uint32_t bufNum, uint32_t bufLen) { return rtlsdr_read_async(dev, cb, ctx, bufNum, bufLen); }
+    int cancelAsync() { return rtlsdr_cancel_async(dev); }
+
+private:
+    LibRTLDevice(rtlsdr_dev_t* dev) : dev(dev) {}
+    rtlsdr_dev_t* dev;
+};
@@ -0,0 +1,189 @@
+#pragma once
+#include <stdint.h>
+
+// Commands other modules can send through core::modComManager to a NEW-RTL-SDR instance.
+// The interface is registered under the instance name with the module name "new_rtlsdr_source".
+enum {
+    RTLSDR_IFACE_CMD_GET_STREAM_STATS,  // out: RTLSDRStreamStats*
+    RTLSDR_IFACE_CMD_GET_GAPS,          // out: std::vector<RTLSDRGapEvent>*, oldest first
+    RTLSDR_IFACE_CMD_RESET_STREAM_STATS,
+    RTLSDR_IFACE_CMD_GET_TELEMETRY,     // out: RTLSDRTelemetry*
+    RTLSDR_IFACE_CMD_GET_TUNE_STATS,    // out: RTLSDRTuneStats*
+    RTLSDR_IFACE_CMD_RESET_TUNE_STATS,
+    RTLSDR_IFACE_CMD_GET_RETUNES,       // out: std::vector<RTLSDRRetuneMarker>*, oldest first
+    RTLSDR_IFACE_CMD_GET_STREAM_POSITION, // out: uint64_t*, samples written to the stream since start
+    RTLSDR_IFACE_CMD_GET_COMMAND_STATS, // out: RTLSDRCommandStats*, all device control commands
+    RTLSDR_IFACE_CMD_GET_START_LATENCY, // out: double*, ms from the last start to its first samples, negative until they came
+    RTLSDR_IFACE_CMD_GET_ADC_STATS,     // out: RTLSDRAdcStats*, last converted block
+    RTLSDR_IFACE_CMD_GET_CLOCK,         // out: RTLSDRClockState*
+    RTLSDR_IFACE_CMD_GET_BLOCK_TIMES,   // out: std::vector<RTLSDRBlockTime>*, recent blocks, oldest first
+    RTLSDR_IFACE_CMD_GET_PPM_CALIBRATION, // out: RTLSDRPpmCalibration*
+    RTLSDR_IFACE_CMD_START_PPM_CALIBRATION, // in: double*, reference in Hz, NULL for the configured one
+    RTLSDR_IFACE_CMD_ADD_RAW_SINK,      // in: RTLSDRRawSink*
+    RTLSDR_IFACE_CMD_REMOVE_RAW_SINK,   // in: RTLSDRRawSink*, matched on handler and ctx
+    RTLSDR_IFACE_CMD_GET_BUFFER_STATS,  // out: RTLSDRBufferStats*
+    RTLSDR_IFACE_CMD_GET_JITTER         // out: RTLSDRJitterStats*, cleared with the stream stats
+};
+
+enum RTLSDRGapType {
+    RTLSDR_GAP_DROPPED,         // Block thrown away because the converter couldn't keep up
+    RTLSDR_GAP_USB_OVERFLOW     // Fewer samples arrived than the sample rate implies
+};
+
+struct RTLSDRGapEvent {
+    RTLSDRGapType type;
+    int64_t time;           // Wall clock, ms since epoch
+    uint64_t sampleIndex;   // Samples received before the gap
+    uint64_t samples;       // Samples lost (estimated for overflows)
+};
+
+struct RTLSDRStreamStats {
+    uint64_t totalSamples;
+    uint64_t droppedBlocks;
+    uint64_t droppedSamples;
+    uint64_t lateCallbacks;
+    uint64_t usbOverflows;
+    uint64_t overflowSamples;
+    int64_t lastGapTime;    // Wall clock, ms since epoch, 0 if there never was a gap
+};
+
+// Last tuner readout of the telemetry sampler, never triggers a USB transfer
+struct RTLSDRTelemetry {
+    int dagc;               // RTL2832 digital AGC gain, 0-255
+    int lnaGain;            // R820T LNA gain step picked by the tuner AGC, 0-15
+    int mixerGain;          // R820T mixer gain step picked by the tuner AGC, 0-15
+    int strength;           // Total gain estimate reported by the driver
+    int64_t time;           // Wall clock of the readout, ms since epoch
+    uint64_t count;         // Readouts since the device was started
+    bool valid;             // False when not running
+};
+
+// Time spent in the tune handler for every retune while running
+struct RTLSDRTuneStats {
+    uint64_t count;
+    double p50;             // us
+    double p99;             // us
+    double max;             // us
+    uint64_t retries;       // Extra set_center_freq calls
+    uint64_t failures;      // Retunes refused every time, or whose R82xx PLL never locked (not read in fast tune)
+    uint64_t skipped;       // Fast tune requests for the frequency already tuned
+};
+
+// Device control commands from the moment they are queued until they completed
+struct RTLSDRCommandStats {
+    uint64_t count;
+    double p50;             // us
+    double p99;             // us
+    double max;             // us
+    uint64_t coalesced;     // Replaced by a newer value before they ran
+    uint64_t dropped;       // Posted while no device was open
+};
+
+// Raw ADC code statistics of one block, gathered while converting
+struct RTLSDRAdcStats {
+    uint32_t histI[256];    // Occurrences of every I byte value
+    uint32_t histQ[256];
+    uint32_t samples;
+    double clipI;           // Fraction of I bytes at 0 or 255
+    double clipQ;
+    double meanI;           // Codes, 127.5 is mid scale
+    double meanQ;
+    double rms;             // dBFS, a full scale complex tone is 0
+    double effectiveBits;   // Entropy of the code histograms, I and Q averaged, 8 at most
+    uint64_t blocks;        // Blocks measured since start
+    uint64_t clippedSamples;// Samples with I or Q at a rail since start, upper bound
+    int64_t time;           // ms since epoch
+};
+
+#define RTLSDR_STREAM_INDEX_PENDING UINT64_MAX
+
+// Where a retune takes effect. sampleIndex counts samples coming off the dongle since start (before
+// decimation and dropping), streamIndex counts samples written to the stream before the first sample
+// at the new frequency and stays RTLSDR_STREAM_INDEX_PENDING until the converter got there.
+struct RTLSDRRetuneMarker {
+    uint64_t sampleIndex;
+    uint64_t streamIndex;
+    double freq;
+    uint32_t settleSamples;     // Length of the settling window after sampleIndex
+    int64_t time;               // Wall clock of the retune, ms since epoch
+};
+
+// Sample clock measured against the host's monotonic clock (std::chrono::steady_clock). The model time
+// of sample n is anchorTime + (n - anchorIndex) * 1e9 / rate.
+struct RTLSDRClockState {
+    double nominalRate;         // Hz
+    double rate;                // Hz, measured
+    double ppm;                 // Measured rate against the nominal one
+    double jitter;              // us, rms of the callback times around the model
+    uint64_t anchorIndex;
+    int64_t anchorTime;         // ns, steady clock
+    int64_t wallOffset;         // ns, add to steady clock times to get ns since epoch
+    uint64_t discontinuities;   // Times the model had to be re-anchored
+    int64_t lastJump;           // Samples the last discontinuity skipped, negative if time went backwards
+    uint64_t lastJumpIndex;
+    bool locked;
+};
+
+// Timestamps of a block of samples
+struct RTLSDRBlockTime {
+    uint64_t sampleIndex;       // First sample off the dongle, like RTLSDRRetuneMarker
+    uint64_t streamIndex;       // Stream position the block was written at
+    int64_t hostTime;           // ns, steady clock when the usb callback ran (end of the block)
+    int64_t modelTime;          // ns, steady clock of the first sample according to the clock model
+};
+
+// Last automatic ppm calibration against a reference carrier
+struct RTLSDRPpmCalibration {
+    bool active;                // Measuring right now
+    bool scheduled;             // Periodic calibration enabled and waiting for the next run
+    bool ok;                    // The last run found the carrier and settled on a ppm
+    int ppm;                    // Correction applied by the last run
+    double error;               // ppm, residual frequency error of the last measurement
+    double snr;                 // dB, carrier over the median bin
+    double refFreq;             // Hz
+    uint64_t runs;
+    int64_t time;               // Wall clock of the last run, ms since epoch, 0 if none
+};
+
+// Native sample formats for raw sinks, interleaved I/Q. The signed formats both put zero at code 128,
+// the float stream uses 127.4 instead: a client wanting the same floats computes (v + 0.6) / 128 from
+// CS8 and (v / 256 + 0.6) / 128 from CS16 (or (v - 127.4) / 128 from CU8).
+enum RTLSDRRawFormat {
+    RTLSDR_RAW_CU8,             // As the dongle sends it
+    RTLSDR_RAW_CS8,             // Byte - 128
+    RTLSDR_RAW_CS16             // (Byte - 128) * 256, CS8 scaled to the 16 bit range
+};
+
+// Gets every block before it's converted to floats (and before decimation), on the converter thread.
+// Must not block, data is only valid during the call.
+typedef void (*RTLSDRRawHandler)(const void* data, int samples, const RTLSDRBlockTime* time, void* ctx);
+
+struct RTLSDRRawSink {
+    RTLSDRRawFormat format;
+    RTLSDRRawHandler handler;
+    void* ctx;
+    bool replacesStream;        // Carries the samples itself (server transport), the float stream is only
+                                // skipped while every sink says so and nothing in the module needs it
+};
+
+// Sample buffers owned by the module
+struct RTLSDRBufferStats {
+    uint64_t poolBytes;         // Preallocated, kept across restarts
+    uint64_t usedBytes;         // Taken by the current stream
+    uint64_t highWater;         // Most ever taken
+    bool hugePages;
+    bool locked;
+    int ringSlots;              // Usb to converter ring
+    int ringOccupancy;
+    int ringHighWater;          // Most slots ever filled at once since start
+};
+
+// How far usb callbacks arrive from one block duration after the previous one
+struct RTLSDRJitterStats {
+    uint64_t count;
+    double p50;                 // us
+    double p99;                 // us
+    double p999;                // us
+    double max;                 // us
+    double interval;            // us, block duration
+};
@@ -0,0 +1,32 @@
+#pragma once
+
+// Sample rates offered in the menu, also used by the benchmark
+const double sampleRates[] = {
+    250000,
+    1024000,
+    1536000,
+    1792000,
+    1920000,
+    2048000,
+    2160000,
+    2400000,
+    2560000,
+    2880000,
+    3200000
+};
+
+const char* const sampleRatesTxt[] = {
+    "250KHz",
+    "1.024MHz",
+    "1.536MHz",
+    "1.792MHz",
+    "1.92MHz",
+    "2.048MHz",
+    "2.16MHz",
+    "2.4MHz",
+    "2.56MHz",
+    "2.88MHz",
+    "3.2MHz"
+};
+
+#define SAMPLE_RATE_COUNT (sizeof(sampleRates) / sizeof(double))
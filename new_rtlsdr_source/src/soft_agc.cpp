@@ -0,0 +1,93 @@
+#include "soft_agc.h"
+#include <math.h>
+#include <algorithm>
+
+// Fraction of ADC codes at either rail that counts as clipping, and how far the ladder drops then
+#define SOFT_AGC_CLIP_FRACTION  1e-4
+#define SOFT_AGC_CLIP_STEPS     4
+
+// Largest correction applied at once for a level error
+#define SOFT_AGC_MAX_STEPS      6
+
+void SoftAgc::reset(double sampleRate, int holdoff) {
+    this->sampleRate = sampleRate;
+    this->holdoff = holdoff;
+    holdoffLeft = 0;
+    primed = false;
+    level = -100.0;
+    clipping = 0.0;
+}
+
+void SoftAgc::setStep(int step) {
+    this->step = std::clamp<int>(step, 0, SOFT_AGC_STEPS - 1);
+}
+
+SoftAgcGains SoftAgc::stepGains(int step) {
+    SoftAgcGains g;
+    step = std::clamp<int>(step, 0, SOFT_AGC_STEPS - 1);
+    if (step < SOFT_AGC_BASE_VGA) {
+        g.lna = 0;
+        g.mixer = 0;
+        g.vga = step;
+    }
+    else if (step <= SOFT_AGC_BASE_VGA + 30) {
+        int s = step - SOFT_AGC_BASE_VGA;
+        g.lna = (s + 1) / 2;
+        g.mixer = s / 2;
+        g.vga = SOFT_AGC_BASE_VGA;
+    }
+    else {
+        g.lna = 15;
+        g.mixer = 15;
+        g.vga = SOFT_AGC_BASE_VGA + (step - SOFT_AGC_BASE_VGA - 30);
+    }
+    return g;
+}
+
+bool SoftAgc::process(double db, double clipFrac, int count, SoftAgcGains& g) {
+    if (!count) { return false; }
+    clipping = clipFrac;
+
+    if (holdoffLeft > 0) {
+        holdoffLeft -= count;
+        return false;
+    }
+
+    double lvl = level;
+    if (!primed) {
+        lvl = db;
+        primed = true;
+    }
+    else {
+        double tau = ((db > lvl) ? attack : decay) / 1000.0;
+        double dt = (double)count / sampleRate;
+        lvl += (db - lvl) * (1.0 - exp(-dt / std::max<double>(tau, 1e-6)));
+    }
+
+    int delta = 0;
+    if (clipFrac > SOFT_AGC_CLIP_FRACTION) {
+        delta = -SOFT_AGC_CLIP_STEPS;
+    }
+    else {
+        double err = lvl - target;
+        if (fabs(err) > hysteresis) {
+            delta = -(int)round(err / SOFT_AGC_STEP_DB);
+            if (!delta) { delta = (err > 0) ? -1 : 1; }
+            delta = std::clamp<int>(delta, -SOFT_AGC_MAX_STEPS, SOFT_AGC_MAX_STEPS);
+        }
+    }
+
+    int cur = step;
+    int next = std::clamp<int>(cur + delta, 0, SOFT_AGC_STEPS - 1);
+    if (next == cur) {
+        level = lvl;
+        return false;
+    }
+
+    // Expect the level to follow the gain, the holdoff then skips the samples still at the old gain
+    level = lvl + (double)(next - cur) * SOFT_AGC_STEP_DB;
+    step = next;
+    holdoffLeft = holdoff;
+    g = stepGains(next);
+    return true;
+}
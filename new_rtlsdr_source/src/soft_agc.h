@@ -0,0 +1,62 @@
+#pragma once
+#include <stdint.h>
+#include <atomic>
+
+// Gain ladder: the VGA covers both ends, LNA and mixer (interleaved) the middle so the front end is
+// turned down first on strong signals and up first on weak ones
+#define SOFT_AGC_BASE_VGA       7
+#define SOFT_AGC_STEPS          (SOFT_AGC_BASE_VGA + 30 + (15 - SOFT_AGC_BASE_VGA) + 1)
+#define SOFT_AGC_STEP_DB        1.5
+
+#define SOFT_AGC_DEFAULT_TARGET     -12.0
+#define SOFT_AGC_DEFAULT_ATTACK     5.0
+#define SOFT_AGC_DEFAULT_DECAY      200.0
+#define SOFT_AGC_DEFAULT_HYSTERESIS 3.0
+
+struct SoftAgcGains {
+    int lna;
+    int mixer;
+    int vga;
+};
+
+// Closed loop gain control on the raw ADC samples. Every block comes in as its power and clipping, the
+// level is smoothed with separate attack and decay time constants and the gain ladder is stepped once
+// it leaves target +/- hysteresis. After a change the measurement is held off until the samples already
+// in flight went by, so the loop doesn't react twice to the same excess.
+class SoftAgc {
+public:
+    // holdoff: samples between a gain change being issued and showing up in process()
+    void reset(double sampleRate, int holdoff);
+
+    void setTarget(double dbfs) { target = dbfs; }
+    void setAttack(double ms) { attack = ms; }
+    void setDecay(double ms) { decay = ms; }
+    void setHysteresis(double db) { hysteresis = db; }
+
+    void setStep(int step);
+    int getStep() { return step; }
+
+    // Converter thread, power in dBFS and fraction of clipped codes of a block of count samples.
+    // True if the gains must change, g gets the new ones.
+    bool process(double db, double clipFrac, int count, SoftAgcGains& g);
+
+    double getLevel() { return level; }
+    double getClipping() { return clipping; }
+
+    static SoftAgcGains stepGains(int step);
+
+private:
+    double sampleRate = 1.0;
+    int holdoff = 0;
+    int64_t holdoffLeft = 0;
+
+    std::atomic<double> target = SOFT_AGC_DEFAULT_TARGET;
+    std::atomic<double> attack = SOFT_AGC_DEFAULT_ATTACK;
+    std::atomic<double> decay = SOFT_AGC_DEFAULT_DECAY;
+    std::atomic<double> hysteresis = SOFT_AGC_DEFAULT_HYSTERESIS;
+
+    std::atomic<int> step = SOFT_AGC_STEPS / 2;
+    std::atomic<double> level = -100.0;
+    std::atomic<double> clipping = 0.0;
+    bool primed = false;
+};
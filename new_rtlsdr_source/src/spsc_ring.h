@@ -0,0 +1,146 @@
+#pragma once
+#include <stdint.h>
+#include <string.h>
+#include <atomic>
+#include <mutex>
+#include <condition_variable>
+#include <vector>
+
+// Travels with every slot
+struct BlockStamp {
+    uint64_t index = 0;     // First sample of the block since start
+    int64_t hostTime = 0;   // ns, steady clock when the block arrived
+    int64_t modelTime = 0;  // ns, steady clock of the first sample according to the clock model
+};
+
+// Single producer / single consumer ring of preallocated byte slots.
+// The producer (libusb thread) never blocks or allocates: it copies into the next free slot or
+// reports the ring as full. The consumer blocks in pop() until a slot is ready or stop() is called.
+class SPSCRing {
+public:
+    ~SPSCRing() {
+        free();
+    }
+
+    // mem (slotCount * slotSize bytes) is used for the slots if given, it must outlive the ring
+    void init(int slotCount, int slotSize, uint8_t* mem = NULL) {
+        free();
+        this->slotCount = slotCount;
+        this->slotSize = slotSize;
+        if (!mem) {
+            data.resize((size_t)slotCount * slotSize);
+            mem = data.data();
+        }
+        slots = mem;
+        lens.resize(slotCount);
+        stamps.resize(slotCount);
+        head = 0;
+        tail = 0;
+        highWater = 0;
+        stopped = false;
+    }
+
+    void free() {
+        data.clear();
+        data.shrink_to_fit();
+        slots = NULL;
+        lens.clear();
+        stamps.clear();
+        slotCount = 0;
+        slotSize = 0;
+        head = 0;
+        tail = 0;
+    }
+
+    // Producer side, returns false if the ring is full or the data doesn't fit a slot
+    bool push(const uint8_t* buf, int len, const BlockStamp& stamp = BlockStamp()) {
+        size_t h = head.load(std::memory_order_relaxed);
+        if (h - tail.load(std::memory_order_acquire) >= (size_t)slotCount || len > slotSize) { return false; }
+
+        int id = h % slotCount;
+        memcpy(&slots[(size_t)id * slotSize], buf, len);
+        lens[id] = len;
+        stamps[id] = stamp;
+        head.store(h + 1, std::memory_order_release);
+
+        int occ = (int)(h + 1 - tail.load(std::memory_order_relaxed));
+        if (occ > highWater.load(std::memory_order_relaxed)) { highWater.store(occ, std::memory_order_relaxed); }
+
+        // Only bother the mutex when the consumer is actually asleep, the fence orders
+        // the head store before reading the flag (pairs with pop() setting it before checking head)
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        if (waiting.load()) {
+            std::lock_guard<std::mutex> lck(waitMtx);
+            cnd.notify_one();
+        }
+        return true;
+    }
+
+    // Consumer side, returns the oldest filled slot or nullptr once stopped.
+    // The slot stays valid until release() is called.
+    uint8_t* pop(int& len, BlockStamp* stamp = NULL) {
+        size_t t = tail.load(std::memory_order_relaxed);
+        if (head.load(std::memory_order_acquire) == t) {
+            std::unique_lock<std::mutex> lck(waitMtx);
+            waiting = true;
+            cnd.wait(lck, [=]() { return head.load() != t || stopped; });
+            waiting = false;
+            if (head.load(std::memory_order_acquire) == t) { return nullptr; }
+        }
+        int id = t % slotCount;
+        len = lens[id];
+        if (stamp) { *stamp = stamps[id]; }
+        return &slots[(size_t)id * slotSize];
+    }
+
+    void release() {
+        tail.store(tail.load(std::memory_order_relaxed) + 1, std::memory_order_release);
+    }
+
+    // Number of filled slots
+    int occupancy() {
+        return (int)(head.load() - tail.load());
+    }
+
+    int capacity() {
+        return slotCount;
+    }
+
+    // Most slots ever filled at once since init()
+    int getHighWater() {
+        return highWater;
+    }
+
+    void stop() {
+        std::lock_guard<std::mutex> lck(waitMtx);
+        stopped = true;
+        cnd.notify_all();
+    }
+
+    void clearStop() {
+        std::lock_guard<std::mutex> lck(waitMtx);
+        stopped = false;
+    }
+
+    // Drop everything that wasn't consumed, only call while neither side is running
+    void flush() {
+        tail = head.load();
+    }
+
+private:
+    std::vector<uint8_t> data;
+    uint8_t* slots = NULL;
+    std::vector<int> lens;
+    std::vector<BlockStamp> stamps;
+    int slotCount = 0;
+    int slotSize = 0;
+
+    alignas(64) std::atomic<size_t> head = 0;
+    alignas(64) std::atomic<size_t> tail = 0;
+
+    std::atomic<int> highWater = 0;
+    std::atomic<bool> waiting = false;
+    bool stopped = false;
+    std::mutex waitMtx;
+    std::condition_variable cnd;
+};
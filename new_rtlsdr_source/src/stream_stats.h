@@ -0,0 +1,184 @@
+#pragma once
+#include <stdint.h>
+#include <math.h>
+#include <atomic>
+#include <chrono>
+#include <vector>
+#include <utils/flog.h>
+#include "rtlsdr_interface.h"
+#include "latency_histogram.h"
+
+#define STREAM_STATS_MAX_GAPS       64
+#define STREAM_STATS_LOG_INTERVAL   1.0
+#define STREAM_STATS_REBASE_TIME    10.0
+
+// Drop and gap accounting for the sample stream. block() and dropped() are called from the
+// libusb thread (dropped() also from the converter) and never block or allocate, gaps go to a
+// fixed ring that keeps the last STREAM_STATS_MAX_GAPS and is read through per slot sequence locks.
+class StreamStats {
+public:
+    // blockSamples * bufferCount is what can legitimately be in flight in librtlsdr
+    void reset(double sampleRate, int blockSamples, int bufferCount) {
+        this->sampleRate = sampleRate;
+        blockInterval = (double)blockSamples / sampleRate;
+        lateThreshold = 2.0 * blockInterval;
+        overflowThreshold = (double)blockSamples * bufferCount + sampleRate * 0.02;
+        started = false;
+        clear();
+    }
+
+    void clear() {
+        totalSamples = 0;
+        droppedBlocks = 0;
+        droppedSamples = 0;
+        lateCallbacks = 0;
+        usbOverflows = 0;
+        overflowSamples = 0;
+        lastGapTime = 0;
+        loggedEvents = 0;
+        jitter.clear();
+        gapCount = 0;
+    }
+
+    // Every usb callback, before the block is handed off
+    void block(uint32_t samples) {
+        auto now = std::chrono::steady_clock::now();
+        if (!started) {
+            started = true;
+            windowStart = now;
+            windowSamples = 0;
+            lastCallback = now;
+        }
+
+        double interval = std::chrono::duration<double>(now - lastCallback).count();
+        if (interval > lateThreshold) { lateCallbacks++; }
+        if (totalSamples) { jitter.add(fabs(interval - blockInterval) * 1e6); }
+        lastCallback = now;
+
+        // Compare what arrived with what the sample rate says should have, the window is
+        // rebased regularly so the dongle's ppm error never adds up to a fake overflow
+        double elapsed = std::chrono::duration<double>(now - windowStart).count();
+        double deficit = elapsed * sampleRate - (double)windowSamples;
+        if (deficit > overflowThreshold) {
+            usbOverflows++;
+            overflowSamples += (uint64_t)deficit;
+            addGap(RTLSDR_GAP_USB_OVERFLOW, totalSamples, (uint64_t)deficit);
+            windowStart = now;
+            windowSamples = 0;
+        }
+        else if (elapsed > STREAM_STATS_REBASE_TIME) {
+            windowStart = now;
+            windowSamples = 0;
+        }
+
+        windowSamples += samples;
+        totalSamples += samples;
+    }
+
+    // Block that had to be thrown away, index is its first sample
+    void dropped(uint32_t samples, uint64_t index) {
+        droppedBlocks++;
+        droppedSamples += samples;
+        addGap(RTLSDR_GAP_DROPPED, index, samples);
+    }
+
+    RTLSDRStreamStats get() {
+        RTLSDRStreamStats s;
+        s.totalSamples = totalSamples;
+        s.droppedBlocks = droppedBlocks;
+        s.droppedSamples = droppedSamples;
+        s.lateCallbacks = lateCallbacks;
+        s.usbOverflows = usbOverflows;
+        s.overflowSamples = overflowSamples;
+        s.lastGapTime = lastGapTime;
+        return s;
+    }
+
+    // Callback inter-arrival time against the block duration
+    RTLSDRJitterStats getJitter() {
+        RTLSDRJitterStats j;
+        j.count = jitter.getCount();
+        j.p50 = jitter.percentile(0.5);
+        j.p99 = jitter.percentile(0.99);
+        j.p999 = jitter.percentile(0.999);
+        j.max = jitter.getMax();
+        j.interval = blockInterval * 1e6;
+        return j;
+    }
+
+    std::vector<RTLSDRGapEvent> getGaps() {
+        std::vector<RTLSDRGapEvent> out;
+        uint64_t n = gapCount.load(std::memory_order_acquire);
+        for (uint64_t i = (n > STREAM_STATS_MAX_GAPS) ? n - STREAM_STATS_MAX_GAPS : 0; i < n; i++) {
+            // Skipped if it's still being written or was overwritten since
+            GapSlot& slot = gaps[i % STREAM_STATS_MAX_GAPS];
+            uint64_t s1 = slot.seq.load(std::memory_order_acquire);
+            RTLSDRGapEvent gap = slot.gap;
+            std::atomic_thread_fence(std::memory_order_acquire);
+            uint64_t s2 = slot.seq.load(std::memory_order_relaxed);
+            if (s1 == 2 * i + 2 && s1 == s2) { out.push_back(gap); }
+        }
+        return out;
+    }
+
+    // Called from the converter thread, logs at most once per STREAM_STATS_LOG_INTERVAL
+    void log(const std::string& name) {
+        uint64_t events = droppedBlocks + usbOverflows;
+        if (events == loggedEvents) { return; }
+        auto now = std::chrono::steady_clock::now();
+        if (std::chrono::duration<double>(now - lastLog).count() < STREAM_STATS_LOG_INTERVAL) { return; }
+        lastLog = now;
+        loggedEvents = events;
+        flog::warn("RTLSDRSourceModule '{0}': {1} dropped blocks ({2} samples), {3} usb overflows (~{4} samples), {5} late callbacks",
+                   name, (uint64_t)droppedBlocks, (uint64_t)droppedSamples, (uint64_t)usbOverflows, (uint64_t)overflowSamples, (uint64_t)lateCallbacks);
+    }
+
+private:
+    struct GapSlot {
+        std::atomic<uint64_t> seq = 0;     // 2n + 1 while event n is written, 2n + 2 once it's done
+        RTLSDRGapEvent gap;
+    };
+
+    void addGap(RTLSDRGapType type, uint64_t index, uint64_t samples) {
+        RTLSDRGapEvent gap;
+        gap.type = type;
+        gap.time = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::system_clock::now().time_since_epoch()).count();
+        gap.sampleIndex = index;
+        gap.samples = samples;
+        lastGapTime = gap.time;
+
+        uint64_t n = gapCount.fetch_add(1, std::memory_order_relaxed);
+        GapSlot& slot = gaps[n % STREAM_STATS_MAX_GAPS];
+        slot.seq.store(2 * n + 1, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_release);
+        slot.gap = gap;
+        slot.seq.store(2 * n + 2, std::memory_order_release);
+    }
+
+    double sampleRate = 1.0;
+    double blockInterval = 0.0;
+    double lateThreshold = 0.0;
+    double overflowThreshold = 0.0;
+
+    // Only touched by the usb thread
+    bool started = false;
+    std::chrono::steady_clock::time_point windowStart;
+    std::chrono::steady_clock::time_point lastCallback;
+    uint64_t windowSamples = 0;
+
+    std::atomic<uint64_t> totalSamples = 0;
+    std::atomic<uint64_t> droppedBlocks = 0;
+    std::atomic<uint64_t> droppedSamples = 0;
+    std::atomic<uint64_t> lateCallbacks = 0;
+    std::atomic<uint64_t> usbOverflows = 0;
+    std::atomic<uint64_t> overflowSamples = 0;
+    std::atomic<int64_t> lastGapTime = 0;
+    LatencyHistogram jitter;
+
+    // Only touched by the converter thread
+    std::atomic<uint64_t> loggedEvents = 0;
+    std::chrono::steady_clock::time_point lastLog;
+
+    GapSlot gaps[STREAM_STATS_MAX_GAPS];
+    std::atomic<uint64_t> gapCount = 0;
+};
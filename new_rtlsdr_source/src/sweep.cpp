@@ -0,0 +1,217 @@
+#include "sweep.h"
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <chrono>
+#include <algorithm>
+#include <utils/flog.h>
+#include "fft.h"
+
+// Fraction of every hop thrown away at the edges (anti-aliasing filter rolloff), split between both sides
+#define SWEEP_CROP  0.25
+
+static double wallTime() {
+    return std::chrono::duration<double>(std::chrono::system_clock::now().time_since_epoch()).count();
+}
+
+Sweeper::~Sweeper() {
+    stop();
+}
+
+bool Sweeper::parseRanges(const std::string& str, std::vector<SweepRange>& ranges) {
+    ranges.clear();
+    const char* p = str.c_str();
+    auto number = [&p](double& val) {
+        char* end;
+        val = strtod(p, &end);
+        if (end == p) { return false; }
+        p = end;
+        if (*p == 'k' || *p == 'K') { val *= 1e3; p++; }
+        else if (*p == 'M') { val *= 1e6; p++; }
+        else if (*p == 'G' || *p == 'g') { val *= 1e9; p++; }
+        return true;
+    };
+
+    while (*p) {
+        if (*p == ' ' || *p == ',' || *p == ';') {
+            p++;
+            continue;
+        }
+        SweepRange r;
+        if (!number(r.start)) { return false; }
+        while (*p == ' ') { p++; }
+        if (*p++ != '-') { return false; }
+        while (*p == ' ') { p++; }
+        if (!number(r.stop)) { return false; }
+        if (r.stop <= r.start || r.start < 0) { return false; }
+        ranges.push_back(r);
+    }
+    return !ranges.empty();
+}
+
+bool Sweeper::start(const SweepParams& params, const std::string& path, tune_t tune, done_t done, void* ctx) {
+    stop();
+    if (params.ranges.empty() || params.fftSize < 16 || (params.fftSize & (params.fftSize - 1))) { return false; }
+
+    file = fopen(path.c_str(), (params.format == SWEEP_FORMAT_CSV) ? "w" : "wb");
+    if (!file) {
+        flog::error("Could not open '{0}' for the sweep output", path);
+        return false;
+    }
+
+    this->params = params;
+    this->path = path;
+    this->tune = tune;
+    this->done = done;
+    this->ctx = ctx;
+
+    // Hops are spaced by the part of the spectrum that survives the crop
+    int n = params.fftSize;
+    cropBins = (int)(n * SWEEP_CROP / 2.0);
+    double usable = (double)(n - 2 * cropBins) * params.sampleRate / (double)n;
+    hops.clear();
+    for (const auto& r : params.ranges) {
+        int count = std::max<int>(1, (int)ceil((r.stop - r.start) / usable));
+        for (int i = 0; i < count; i++) {
+            hops.push_back(r.start + usable * ((double)i + 0.5));
+        }
+    }
+
+    // Everything the worker needs is allocated here
+    int averages = std::max<int>(1, (int)round(params.dwell * params.sampleRate / (double)n));
+    captureSize = averages * n;
+    capture.resize((size_t)captureSize * 2);
+    work.resize((size_t)n * 2);
+    power.resize(n);
+    fft::hann(window, n);
+    fft::twiddles(twiddle, n);
+
+    hop = 0;
+    sweeps = 0;
+    state = SWEEP_STATE_IDLE;
+    running = true;
+    workerThread = std::thread(&Sweeper::worker, this);
+    flog::info("Sweep started: {0} hops of {1} samples into '{2}'", hops.size(), captureSize, path);
+    return true;
+}
+
+void Sweeper::stop() {
+    {
+        std::lock_guard<std::mutex> lck(mtx);
+        running = false;
+    }
+    cnd.notify_all();
+    if (workerThread.joinable()) { workerThread.join(); }
+}
+
+void Sweeper::feed(const float* data, int count) {
+    if (state.load(std::memory_order_acquire) != SWEEP_STATE_CAPTURE) { return; }
+
+    if (discard) {
+        int n = (int)std::min<uint64_t>(discard, count);
+        discard -= n;
+        data += n * 2;
+        count -= n;
+    }
+
+    int n = std::min<int>(count, captureSize - captured);
+    if (n <= 0) { return; }
+    memcpy(&capture[(size_t)captured * 2], data, (size_t)n * 2 * sizeof(float));
+    captured += n;
+
+    if (captured == captureSize) {
+        std::lock_guard<std::mutex> lck(mtx);
+        state.store(SWEEP_STATE_DONE, std::memory_order_release);
+        cnd.notify_all();
+    }
+}
+
+void Sweeper::worker() {
+    while (running) {
+        double sweepStart = wallTime();
+        for (int h = 0; h < (int)hops.size() && running; h++) {
+            hop = h;
+            uint64_t inFlight = tune(hops[h], ctx);
+
+            std::unique_lock<std::mutex> lck(mtx);
+            discard = (uint64_t)(params.settle * params.sampleRate) + inFlight;
+            captured = 0;
+            state.store(SWEEP_STATE_CAPTURE, std::memory_order_release);
+            cnd.wait(lck, [this]() { return state == SWEEP_STATE_DONE || !running; });
+            state = SWEEP_STATE_IDLE;
+            lck.unlock();
+
+            if (!running) { break; }
+            process(hops[h]);
+        }
+        if (!running) { break; }
+
+        sweeps++;
+        lastSweepTime = wallTime() - sweepStart;
+        if (!params.loop) { break; }
+    }
+
+    state = SWEEP_STATE_IDLE;
+    fclose(file);
+    file = NULL;
+    running = false;
+    flog::info("Sweep stopped after {0} complete sweeps", (uint64_t)sweeps);
+    if (done) { done(ctx); }
+}
+
+void Sweeper::process(double freq) {
+    int n = params.fftSize;
+    std::fill(power.begin(), power.end(), 0.0);
+
+    for (int seg = 0; seg < captureSize / n; seg++) {
+        const float* in = &capture[(size_t)seg * n * 2];
+        for (int i = 0; i < n; i++) {
+            work[2 * i] = in[2 * i] * window[i];
+            work[2 * i + 1] = in[2 * i + 1] * window[i];
+        }
+        fft::transform(work.data(), n, twiddle.data());
+        for (int i = 0; i < n; i++) {
+            power[i] += (double)work[2 * i] * work[2 * i] + (double)work[2 * i + 1] * work[2 * i + 1];
+        }
+    }
+
+    // 0 dB is a full scale tone, window coherent gain is n/2
+    double norm = (double)(captureSize / n) * (double)n * (double)n / 4.0;
+    for (int i = 0; i < n; i++) { power[i] = 10.0 * log10(power[i] / norm + 1e-20); }
+
+    write(freq, cropBins, n - 2 * cropBins);
+}
+
+void Sweeper::write(double freq, int firstBin, int bins) {
+    int n = params.fftSize;
+    double step = params.sampleRate / (double)n;
+    double low = freq + (double)(firstBin - n / 2) * step;
+
+    if (params.format == SWEEP_FORMAT_CSV) {
+        time_t now = time(NULL);
+        tm* ltm = localtime(&now);
+        char tbuf[64];
+        strftime(tbuf, sizeof(tbuf), "%Y-%m-%d, %H:%M:%S", ltm);
+        fprintf(file, "%s, %.0lf, %.0lf, %.2lf, %d", tbuf, low, low + step * bins, step, captureSize);
+        for (int i = 0; i < bins; i++) {
+            // Bin 0 of the FFT is DC, shift so the output goes from low to high frequency
+            fprintf(file, ", %.2lf", power[(firstBin + i + n / 2) % n]);
+        }
+        fprintf(file, "\n");
+    }
+    else {
+        SweepRecord rec;
+        rec.time = wallTime();
+        rec.freqLow = low;
+        rec.freqStep = step;
+        rec.bins = bins;
+        rec.samples = captureSize;
+        fwrite(&rec, sizeof(rec), 1, file);
+        for (int i = 0; i < bins; i++) {
+            float db = (float)power[(firstBin + i + n / 2) % n];
+            fwrite(&db, sizeof(float), 1, file);
+        }
+    }
+    fflush(file);
+}
@@ -0,0 +1,112 @@
+#pragma once
+#include <stdint.h>
+#include <stdio.h>
+#include <string>
+#include <vector>
+#include <thread>
+#include <mutex>
+#include <atomic>
+#include <condition_variable>
+
+enum SweepFormat {
+    SWEEP_FORMAT_CSV,       // rtl_power compatible lines
+    SWEEP_FORMAT_BINARY     // SweepRecord followed by bins float dB values, little endian
+};
+
+// Header of every hop in the binary survey output
+#pragma pack(push, 1)
+struct SweepRecord {
+    double time;            // Wall clock at the end of the dwell, s since epoch
+    double freqLow;         // Center of the first bin in Hz
+    double freqStep;        // Bin spacing in Hz
+    uint32_t bins;
+    uint32_t samples;       // Samples averaged
+};
+#pragma pack(pop)
+
+struct SweepRange {
+    double start;
+    double stop;
+};
+
+struct SweepParams {
+    std::vector<SweepRange> ranges;
+    double sampleRate;
+    int fftSize;            // Power of two
+    double dwell;           // s of signal averaged per hop
+    double settle;          // s discarded after every retune on top of what was already in flight
+    int format;
+    bool loop;
+};
+
+// Power survey: steps through the ranges, after every retune throws away the settling samples, captures
+// the dwell, and averages FFT power bins on its own thread. The edges of every hop are cropped and the
+// hops overlap accordingly, like rtl_power does.
+class Sweeper {
+public:
+    // Retunes the device, returns how many samples that are already on their way predate the retune
+    typedef uint64_t (*tune_t)(double freq, void* ctx);
+
+    // Called from the sweep thread once it stopped, whether it finished or was stopped
+    typedef void (*done_t)(void* ctx);
+
+    ~Sweeper();
+
+    // Parses "88M-108M, 430M-440M", k/M/G suffixes are allowed
+    static bool parseRanges(const std::string& str, std::vector<SweepRange>& ranges);
+
+    bool start(const SweepParams& params, const std::string& path, tune_t tune, done_t done, void* ctx);
+    void stop();
+    bool isRunning() { return running; }
+
+    // Converter thread, full rate interleaved samples
+    void feed(const float* data, int count);
+
+    int getHop() { return hop; }
+    int getHopCount() { return hops.size(); }
+    uint64_t getSweeps() { return sweeps; }
+    double getLastSweepTime() { return lastSweepTime; }
+    std::string getPath() { return path; }
+
+private:
+    enum {
+        SWEEP_STATE_IDLE,
+        SWEEP_STATE_CAPTURE,
+        SWEEP_STATE_DONE
+    };
+
+    void worker();
+    void process(double freq);
+    void write(double freq, int firstBin, int bins);
+
+    SweepParams params;
+    std::string path;
+    FILE* file = NULL;
+    tune_t tune = NULL;
+    done_t done = NULL;
+    void* ctx = NULL;
+
+    std::vector<double> hops;
+    int cropBins = 0;
+
+    std::thread workerThread;
+    std::mutex mtx;
+    std::condition_variable cnd;
+    std::atomic<bool> running = false;
+    std::atomic<int> state = SWEEP_STATE_IDLE;
+
+    // Only touched by feed() while capturing
+    uint64_t discard = 0;
+    int captured = 0;
+    int captureSize = 0;
+    std::vector<float> capture;
+
+    std::vector<float> window;
+    std::vector<float> twiddle;
+    std::vector<float> work;
+    std::vector<double> power;
+
+    std::atomic<int> hop = 0;
+    std::atomic<uint64_t> sweeps = 0;
+    std::atomic<double> lastSweepTime = 0.0;
+};
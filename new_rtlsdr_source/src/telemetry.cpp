@@ -0,0 +1,137 @@
+#include "telemetry.h"
+#include <chrono>
+#include <algorithm>
+
+// R820T register 0x03 holds the mixer (high nibble) and LNA (low nibble) gains the AGC settled on
+#define TELEMETRY_GAIN_REG  3
+#define TELEMETRY_REG_COUNT 4
+#define TELEMETRY_REG_BUF   128
+
+static int64_t steadyNs() {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+TelemetrySampler::~TelemetrySampler() {
+    stop();
+}
+
+void TelemetrySampler::start(DeviceExecutor* executor, int rate) {
+    stop();
+    this->executor = executor;
+    this->rate = std::clamp<int>(rate, 0, TELEMETRY_MAX_RATE);
+    publish(RTLSDRTelemetry {});
+    lastGet = steadyNs();
+    {
+        std::lock_guard<std::mutex> lck(mtx);
+        running = true;
+        idle = false;
+    }
+    workerThread = std::thread(&TelemetrySampler::worker, this);
+}
+
+void TelemetrySampler::stop() {
+    {
+        std::lock_guard<std::mutex> lck(mtx);
+        running = false;
+    }
+    cnd.notify_all();
+    if (workerThread.joinable()) { workerThread.join(); }
+
+    // Keep the last values but mark them as stale, a read still queued on the executor sees running cleared
+    RTLSDRTelemetry t = load();
+    t.valid = false;
+    publish(t);
+    executor = NULL;
+}
+
+void TelemetrySampler::setRate(int rate) {
+    {
+        std::lock_guard<std::mutex> lck(mtx);
+        this->rate = std::clamp<int>(rate, 0, TELEMETRY_MAX_RATE);
+    }
+    cnd.notify_all();
+}
+
+RTLSDRTelemetry TelemetrySampler::get() {
+    lastGet = steadyNs();
+    if (sleeping) {
+        {
+            std::lock_guard<std::mutex> lck(mtx);
+            idle = false;
+        }
+        cnd.notify_all();
+    }
+    return load();
+}
+
+RTLSDRTelemetry TelemetrySampler::load() {
+    RTLSDRTelemetry t;
+    uint32_t s1, s2;
+    do {
+        s1 = seq.load(std::memory_order_acquire);
+        t = snapshot;
+        std::atomic_thread_fence(std::memory_order_acquire);
+        s2 = seq.load(std::memory_order_relaxed);
+    } while ((s1 & 1) || s1 != s2);
+    return t;
+}
+
+void TelemetrySampler::publish(const RTLSDRTelemetry& t) {
+    seq.fetch_add(1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+    snapshot = t;
+    seq.fetch_add(1, std::memory_order_release);
+}
+
+void TelemetrySampler::read(RTLDevice* dev) {
+    // Only ever published from the executor (and stop()), the snapshot is the previous read
+    RTLSDRTelemetry t = load();
+    unsigned char regs[TELEMETRY_REG_BUF] = { 0 };
+    int len = TELEMETRY_REG_COUNT;
+    int strength = 0;
+    t.dagc = dev->getDagcGain();
+    dev->getTunerI2cRegister(regs, &len, &strength);
+    t.mixerGain = (regs[TELEMETRY_GAIN_REG] & 0xF0) >> 4;
+    t.lnaGain = regs[TELEMETRY_GAIN_REG] & 0x0F;
+    t.strength = strength;
+    t.time = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::system_clock::now().time_since_epoch()).count();
+    t.count++;
+    t.valid = true;
+
+    std::lock_guard<std::mutex> lck(mtx);
+    if (!running) { return; }
+    publish(t);
+}
+
+void TelemetrySampler::worker() {
+    auto next = std::chrono::steady_clock::now();
+    std::unique_lock<std::mutex> lck(mtx);
+    while (running) {
+        auto wanted = [this]() { return (double)(steadyNs() - lastGet) * 1e-9 <= TELEMETRY_IDLE_TIME; };
+        if (!wanted()) {
+            // get() stores lastGet before looking at sleeping, one of the two always sees the other
+            idle = true;
+            sleeping = true;
+            cnd.wait(lck, [&]() { return !running || !idle || wanted(); });
+            sleeping = false;
+            next = std::chrono::steady_clock::now();
+            continue;
+        }
+        if (!rate) {
+            cnd.wait(lck);
+            next = std::chrono::steady_clock::now();
+            continue;
+        }
+        int period = 1000000 / rate;
+        lck.unlock();
+
+        // A read still waiting behind slow commands gets replaced, they never pile up
+        executor->post(DEV_CMD_TELEMETRY, [this](RTLDevice* dev) { read(dev); });
+
+        lck.lock();
+        next += std::chrono::microseconds(period);
+        auto now = std::chrono::steady_clock::now();
+        if (next < now) { next = now; }
+        cnd.wait_until(lck, next, [this]() { return !running; });
+    }
+}
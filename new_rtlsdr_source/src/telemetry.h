@@ -0,0 +1,52 @@
+#pragma once
+#include <stdint.h>
+#include <thread>
+#include <mutex>
+#include <atomic>
+#include <condition_variable>
+#include "rtl_device.h"
+#include "device_executor.h"
+#include "rtlsdr_interface.h"
+
+#define TELEMETRY_DEFAULT_RATE  10
+#define TELEMETRY_MAX_RATE      100
+
+// Sampling stops once nothing called get() for this long, and resumes with the next call
+#define TELEMETRY_IDLE_TIME     2.0
+
+// Polls the DAGC and tuner gain registers at a fixed rate so the UI and other modules never do USB
+// control transfers themselves. The sampler thread only keeps time, the reads are posted to the
+// executor so they never switch the I2C repeater under a tune. Readers get the last snapshot through
+// a sequence lock and never wait for the sampler. Nothing is read while nobody asks: the first get()
+// after an idle period returns the last snapshot (see its time) and wakes the sampler up.
+class TelemetrySampler {
+public:
+    ~TelemetrySampler();
+
+    // rate: reads per second, 0 disables sampling
+    void start(DeviceExecutor* executor, int rate);
+    void stop();
+    void setRate(int rate);
+
+    RTLSDRTelemetry get();
+
+private:
+    void worker();
+    void read(RTLDevice* dev);
+    RTLSDRTelemetry load();
+    void publish(const RTLSDRTelemetry& t);
+
+    DeviceExecutor* executor = NULL;
+    std::thread workerThread;
+    std::mutex mtx;
+    std::condition_variable cnd;
+    bool running = false;
+    bool idle = false;
+    int rate = TELEMETRY_DEFAULT_RATE;
+    std::atomic<int64_t> lastGet = 0;     // steady clock ns
+    std::atomic<bool> sleeping = false;
+
+    // Odd while the snapshot is being written
+    std::atomic<uint32_t> seq = 0;
+    RTLSDRTelemetry snapshot = {};
+};
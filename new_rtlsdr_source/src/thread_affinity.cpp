@@ -0,0 +1,85 @@
+#include "thread_affinity.h"
+#include <stdlib.h>
+#include <algorithm>
+
+#if defined(_WIN32)
+#include <windows.h>
+#else
+#include <pthread.h>
+#include <sched.h>
+#endif
+
+namespace affinity {
+    bool parse(const std::string& str, std::vector<int>& cpus) {
+        cpus.clear();
+        const char* p = str.c_str();
+        while (*p) {
+            if (*p == ' ' || *p == ',') {
+                p++;
+                continue;
+            }
+
+            char* end;
+            long first = strtol(p, &end, 10);
+            if (end == p || first < 0) { return false; }
+            long last = first;
+            p = end;
+            if (*p == '-') {
+                last = strtol(++p, &end, 10);
+                if (end == p || last < first) { return false; }
+                p = end;
+            }
+            if (*p && *p != ',' && *p != ' ') { return false; }
+
+            for (long i = first; i <= last; i++) { cpus.push_back(i); }
+        }
+        return true;
+    }
+
+    bool apply(std::thread& thread, const std::vector<int>& cpus) {
+        if (cpus.empty() || !thread.joinable()) { return true; }
+#if defined(_WIN32)
+        DWORD_PTR mask = 0;
+        for (int cpu : cpus) {
+            if (cpu < (int)sizeof(DWORD_PTR) * 8) { mask |= (DWORD_PTR)1 << cpu; }
+        }
+        if (!mask) { return false; }
+        return SetThreadAffinityMask((HANDLE)thread.native_handle(), mask) != 0;
+#elif defined(__linux__)
+        cpu_set_t set;
+        CPU_ZERO(&set);
+        for (int cpu : cpus) {
+            if (cpu < CPU_SETSIZE) { CPU_SET(cpu, &set); }
+        }
+        return pthread_setaffinity_np(thread.native_handle(), sizeof(set), &set) == 0;
+#else
+        // No affinity API (macOS only has hints), run unpinned
+        return false;
+#endif
+    }
+
+    bool setPriority(std::thread& thread, int policy, int priority) {
+        if (!thread.joinable()) { return true; }
+#if defined(_WIN32)
+        // No policies, only priority classes
+        int prio = THREAD_PRIORITY_NORMAL;
+        if (policy != POLICY_NORMAL) { prio = (priority >= 50) ? THREAD_PRIORITY_TIME_CRITICAL : THREAD_PRIORITY_HIGHEST; }
+        return SetThreadPriority((HANDLE)thread.native_handle(), prio) != 0;
+#else
+        int pol = SCHED_OTHER;
+        if (policy == POLICY_FIFO) { pol = SCHED_FIFO; }
+        else if (policy == POLICY_RR) { pol = SCHED_RR; }
+        sched_param param = {};
+        if (pol != SCHED_OTHER) {
+            int lo = sched_get_priority_min(pol);
+            int hi = sched_get_priority_max(pol);
+            param.sched_priority = lo + (int)((double)(hi - lo) * (double)(std::clamp<int>(priority, 1, 99) - 1) / 98.0);
+        }
+        return pthread_setschedparam(thread.native_handle(), pol, &param) == 0;
+#endif
+    }
+
+    int cpuCount() {
+        return std::thread::hardware_concurrency();
+    }
+}
@@ -0,0 +1,25 @@
+#pragma once
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace affinity {
+    enum Policy {
+        POLICY_NORMAL,
+        POLICY_FIFO,
+        POLICY_RR
+    };
+
+    // Parses a CPU list like "0,2-3", returns false if the string is malformed. An empty string gives an empty list.
+    bool parse(const std::string& str, std::vector<int>& cpus);
+
+    // Pins a thread to the given CPUs, an empty list leaves the thread alone
+    bool apply(std::thread& thread, const std::vector<int>& cpus);
+
+    // Scheduling policy and priority (1-99, fitted into what the policy allows) of a thread. False if the
+    // OS refused, real time policies need CAP_SYS_NICE or an rtprio limit on Linux. The thread then
+    // keeps running as it was.
+    bool setPriority(std::thread& thread, int policy, int priority);
+
+    int cpuCount();
+}
@@ -0,0 +1,47 @@
+#include "tuner_regs.h"
+#include "rtl_device.h"
+
+void TunerRegs::write(RTLDevice* dev, int reg, uint8_t mask, uint8_t data) {
+    std::lock_guard<std::recursive_mutex> lck(mtx);
+    if (reg < TUNER_REG_FIRST || reg >= TUNER_REG_COUNT) {
+        dev->setTunerI2cRegister(reg, mask, data);
+        writes++;
+        return;
+    }
+
+    // Later writes to the same bits win, different bits of the same register merge
+    pending[reg] = (pending[reg] & ~mask) | (data & mask);
+    pendingMask[reg] |= mask;
+    dirty |= 1u << reg;
+}
+
+int TunerRegs::flush(RTLDevice* dev) {
+    std::lock_guard<std::recursive_mutex> lck(mtx);
+    int count = 0;
+    for (int reg = TUNER_REG_FIRST; dirty && reg < TUNER_REG_COUNT; reg++) {
+        if (!(dirty & (1u << reg))) { continue; }
+        dirty &= ~(1u << reg);
+
+        uint8_t mask = pendingMask[reg];
+        uint8_t val = pending[reg] & mask;
+        pendingMask[reg] = 0;
+
+        if ((known[reg] & mask) == mask && (shadow[reg] & mask) == val) {
+            skipped++;
+            continue;
+        }
+
+        dev->setTunerI2cRegister(reg, mask, val);
+        shadow[reg] = (shadow[reg] & ~mask) | val;
+        known[reg] |= mask;
+        writes++;
+        count++;
+    }
+    return count;
+}
+
+void TunerRegs::invalidate(RTLDevice* dev) {
+    std::lock_guard<std::recursive_mutex> lck(mtx);
+    flush(dev);
+    for (int reg = 0; reg < TUNER_REG_COUNT; reg++) { known[reg] = 0; }
+}
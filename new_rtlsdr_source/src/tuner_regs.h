@@ -0,0 +1,37 @@
+#pragma once
+#include <stdint.h>
+#include <mutex>
+
+// R820T/R828D registers 0x05-0x1F are writable, 0x00-0x04 are read only status
+#define TUNER_REG_FIRST     0x05
+#define TUNER_REG_COUNT     0x20
+
+class RTLDevice;
+
+// Shadow copy of the writable tuner registers. Masked writes are merged per register until flush(),
+// which sends one masked write per dirty register and skips registers whose known value already
+// matches. librtlsdr also writes these registers (tuning, gain, bandwidth...), the device has to call
+// invalidate() before doing so, which flushes first to keep the order and then forgets the shadow.
+class TunerRegs {
+public:
+    // Queues a write, registers below TUNER_REG_FIRST are written through right away
+    void write(RTLDevice* dev, int reg, uint8_t mask, uint8_t data);
+
+    // Returns the number of USB writes done
+    int flush(RTLDevice* dev);
+
+    void invalidate(RTLDevice* dev);
+
+    uint64_t getWrites() { return writes; }
+    uint64_t getSkipped() { return skipped; }
+
+private:
+    std::recursive_mutex mtx;
+    uint8_t shadow[TUNER_REG_COUNT] = { 0 };
+    uint8_t known[TUNER_REG_COUNT] = { 0 };     // Bits of the shadow that match the hardware
+    uint8_t pending[TUNER_REG_COUNT] = { 0 };
+    uint8_t pendingMask[TUNER_REG_COUNT] = { 0 };
+    uint32_t dirty = 0;
+    uint64_t writes = 0;
+    uint64_t skipped = 0;
+};
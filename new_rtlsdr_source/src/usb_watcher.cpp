@@ -0,0 +1,140 @@
+#include "usb_watcher.h"
+#include <utils/flog.h>
+
+#ifdef HAVE_LIBUSB
+#include <libusb.h>
+#endif
+
+#define USB_WATCHER_MAX_PORTS   8
+
+// Same list and order as librtlsdr's known_devices, device indices only line up if it matches
+static const uint16_t knownDevices[][2] = {
+    { 0x0bda, 0x2832 }, { 0x0bda, 0x2838 }, { 0x0413, 0x6680 }, { 0x0413, 0x6f0f },
+    { 0x0458, 0x707f }, { 0x0ccd, 0x00a9 }, { 0x0ccd, 0x00b3 }, { 0x0ccd, 0x00b4 },
+    { 0x0ccd, 0x00b5 }, { 0x0ccd, 0x00b7 }, { 0x0ccd, 0x00b8 }, { 0x0ccd, 0x00b9 },
+    { 0x0ccd, 0x00c0 }, { 0x0ccd, 0x00c6 }, { 0x0ccd, 0x00d3 }, { 0x0ccd, 0x00d7 },
+    { 0x0ccd, 0x00e0 }, { 0x1554, 0x5020 }, { 0x15f4, 0x0131 }, { 0x15f4, 0x0133 },
+    { 0x185b, 0x0620 }, { 0x185b, 0x0650 }, { 0x185b, 0x0680 }, { 0x1b80, 0xd393 },
+    { 0x1b80, 0xd394 }, { 0x1b80, 0xd395 }, { 0x1b80, 0xd397 }, { 0x1b80, 0xd398 },
+    { 0x1b80, 0xd39d }, { 0x1b80, 0xd3a4 }, { 0x1b80, 0xd3a8 }, { 0x1b80, 0xd3af },
+    { 0x1b80, 0xd3b0 }, { 0x1d19, 0x1101 }, { 0x1d19, 0x1102 }, { 0x1d19, 0x1103 },
+    { 0x1d19, 0x1104 }, { 0x1f4d, 0xa803 }, { 0x1f4d, 0xb803 }, { 0x1f4d, 0xc803 },
+    { 0x1f4d, 0xd286 }, { 0x1f4d, 0xd803 }
+};
+
+UsbWatcher::~UsbWatcher() {
+    stop();
+#ifdef HAVE_LIBUSB
+    if (usbCtx) { libusb_exit((libusb_context*)usbCtx); }
+#endif
+}
+
+bool UsbWatcher::isKnown(uint16_t vid, uint16_t pid) {
+    for (const auto& d : knownDevices) {
+        if (d[0] == vid && d[1] == pid) { return true; }
+    }
+    return false;
+}
+
+#ifdef HAVE_LIBUSB
+
+// "bus-port.port...", still readable from the hotplug callback of a dongle that was removed
+static std::string locationOf(libusb_device* dev) {
+    std::string location = std::to_string(libusb_get_bus_number(dev));
+    uint8_t ports[USB_WATCHER_MAX_PORTS];
+    int n = libusb_get_port_numbers(dev, ports, USB_WATCHER_MAX_PORTS);
+    for (int p = 0; p < n; p++) {
+        location += ((p == 0) ? "-" : ".") + std::to_string(ports[p]);
+    }
+    return location;
+}
+
+static int LIBUSB_CALL hotplugHandler(libusb_context* usbCtx, libusb_device* dev, libusb_hotplug_event event, void* ctx) {
+    libusb_device_descriptor dd;
+    if (libusb_get_device_descriptor(dev, &dd) == LIBUSB_SUCCESS) {
+        ((UsbWatcher*)ctx)->notify(dd.idVendor, dd.idProduct, locationOf(dev));
+    }
+    return 0;
+}
+
+bool UsbWatcher::init() {
+    if (usbCtx) { return true; }
+    libusb_context* c;
+    if (libusb_init(&c) < 0) { return false; }
+    usbCtx = c;
+    return true;
+}
+
+bool UsbWatcher::enumerate(std::vector<UsbDongle>& dongles) {
+    dongles.clear();
+    if (!init()) { return false; }
+
+    libusb_device** list;
+    ssize_t count = libusb_get_device_list((libusb_context*)usbCtx, &list);
+    if (count < 0) { return false; }
+    for (ssize_t i = 0; i < count; i++) {
+        libusb_device_descriptor dd;
+        if (libusb_get_device_descriptor(list[i], &dd) != LIBUSB_SUCCESS) { continue; }
+        if (!isKnown(dd.idVendor, dd.idProduct)) { continue; }
+
+        UsbDongle d;
+        d.vid = dd.idVendor;
+        d.pid = dd.idProduct;
+        d.location = locationOf(list[i]);
+        dongles.push_back(d);
+    }
+    libusb_free_device_list(list, 1);
+    return true;
+}
+
+bool UsbWatcher::start(changed_t changed, void* ctx) {
+    stop();
+    if (!init() || !libusb_has_capability(LIBUSB_CAP_HAS_HOTPLUG)) { return false; }
+    this->changed = changed;
+    this->ctx = ctx;
+
+    libusb_hotplug_callback_handle h;
+    int err = libusb_hotplug_register_callback((libusb_context*)usbCtx,
+                                               (libusb_hotplug_event)(LIBUSB_HOTPLUG_EVENT_DEVICE_ARRIVED | LIBUSB_HOTPLUG_EVENT_DEVICE_LEFT),
+                                               (libusb_hotplug_flag)0, LIBUSB_HOTPLUG_MATCH_ANY, LIBUSB_HOTPLUG_MATCH_ANY,
+                                               LIBUSB_HOTPLUG_MATCH_ANY, hotplugHandler, this, &h);
+    if (err != LIBUSB_SUCCESS) {
+        flog::warn("Could not register the USB hotplug callback: {0}", err);
+        return false;
+    }
+    handle = h;
+    running = true;
+    workerThread = std::thread(&UsbWatcher::worker, this);
+    return true;
+}
+
+void UsbWatcher::stop() {
+    if (!running) { return; }
+    running = false;
+
+    // Deregistering wakes up the event thread
+    libusb_hotplug_deregister_callback((libusb_context*)usbCtx, handle);
+    if (workerThread.joinable()) { workerThread.join(); }
+}
+
+void UsbWatcher::worker() {
+    while (running) {
+        timeval tv = { 0, 200000 };
+        libusb_handle_events_timeout_completed((libusb_context*)usbCtx, &tv, NULL);
+    }
+}
+
+#else
+
+bool UsbWatcher::init() { return false; }
+bool UsbWatcher::enumerate(std::vector<UsbDongle>& dongles) { return false; }
+bool UsbWatcher::start(changed_t changed, void* ctx) { return false; }
+void UsbWatcher::stop() {}
+void UsbWatcher::worker() {}
+
+#endif
+
+void UsbWatcher::notify(uint16_t vid, uint16_t pid, const std::string& location) {
+    if (!isKnown(vid, pid) || !changed) { return; }
+    changed(location, ctx);
+}
@@ -0,0 +1,46 @@
+#pragma once
+#include <stdint.h>
+#include <string>
+#include <vector>
+#include <thread>
+#include <atomic>
+
+struct UsbDongle {
+    uint16_t vid;
+    uint16_t pid;
+    std::string location;       // "bus-port.port...", stable as long as the dongle stays in the same port
+};
+
+// Lists RTL2832U dongles through libusb without opening them, and reports dongles being plugged in or
+// removed. Only built where the module links libusb itself (HAVE_LIBUSB), elsewhere enumerate() fails
+// and start() reports no hotplug support so the caller keeps doing it the librtlsdr way.
+class UsbWatcher {
+public:
+    // location is the port the dongle was plugged into or removed from
+    typedef void (*changed_t)(const std::string& location, void* ctx);
+
+    ~UsbWatcher();
+
+    // Same order as the librtlsdr device indices
+    bool enumerate(std::vector<UsbDongle>& dongles);
+
+    // False if the platform has no hotplug notifications, changed is called from the event thread
+    bool start(changed_t changed, void* ctx);
+    void stop();
+
+    // From the libusb hotplug callback
+    void notify(uint16_t vid, uint16_t pid, const std::string& location);
+
+private:
+    bool init();
+    void worker();
+
+    static bool isKnown(uint16_t vid, uint16_t pid);
+
+    void* usbCtx = NULL;
+    int handle = 0;
+    changed_t changed = NULL;
+    void* ctx = NULL;
+    std::thread workerThread;
+    std::atomic<bool> running = false;
+};